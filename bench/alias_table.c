@@ -0,0 +1,231 @@
+/**
+ * @file alias_table.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Cost of the alias table operations with 10, 1k and 100k aliases, for the old chained table (101 fixed buckets of linked nodes, reproduced here) and the open addressing hashtable. Lookups are split into hits and misses; the shell looks up every command name, and most of them aren't aliases.
+ *
+ * Usage: bench_alias_table [-n lookups]
+ * @version 0.1
+ * @date 2023-07-27
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "bench.h"
+#include "hashtable.h"
+
+#include <string.h>
+
+/*------------------------------- The old table ---------------------------------------*/
+
+typedef struct OldEntry
+{
+    char *key;
+    char *value;
+    struct OldEntry *next;
+} OldEntry;
+
+typedef struct OldList
+{
+    OldEntry *head;
+    OldEntry *tail;
+} OldList;
+
+typedef struct OldTable
+{
+    int size;
+    OldList **buckets;
+} OldTable;
+
+static unsigned long oldHash(const char *str)
+{
+    unsigned long hash = 5381;
+    int c;
+    while ((c = *str++))
+        hash = ((hash << 5) + hash) + c;
+    return hash;
+}
+
+static OldTable *oldCreate(int size)
+{
+    OldTable *table = malloc(sizeof(OldTable));
+    table->size = size;
+    table->buckets = malloc(sizeof(OldList *) * size);
+    for (int i = 0; i < size; i++)
+        table->buckets[i] = calloc(1, sizeof(OldList));
+    return table;
+}
+
+static OldEntry *oldFind(OldTable *table, const char *key)
+{
+    for (OldEntry *entry = table->buckets[oldHash(key) % table->size]->head; entry; entry = entry->next)
+    {
+        if (strcmp(entry->key, key) == 0)
+            return entry;
+    }
+    return NULL;
+}
+
+static void oldSet(OldTable *table, const char *key, const char *value)
+{
+    OldEntry *entry = oldFind(table, key);
+    if (entry)
+    {
+        free(entry->value);
+        entry->value = value ? strdup(value) : NULL;
+        return;
+    }
+
+    entry = malloc(sizeof(OldEntry));
+    entry->key = strdup(key);
+    entry->value = value ? strdup(value) : NULL;
+    entry->next = NULL;
+
+    OldList *list = table->buckets[oldHash(key) % table->size];
+    if (list->tail)
+        list->tail->next = entry;
+    else
+        list->head = entry;
+    list->tail = entry;
+}
+
+static char *oldGet(OldTable *table, const char *key)
+{
+    OldEntry *entry = oldFind(table, key);
+    return entry ? entry->value : NULL;
+}
+
+static void oldDelete(OldTable *table)
+{
+    for (int i = 0; i < table->size; i++)
+    {
+        OldEntry *entry = table->buckets[i]->head;
+        while (entry)
+        {
+            OldEntry *next = entry->next;
+            free(entry->key);
+            free(entry->value);
+            free(entry);
+            entry = next;
+        }
+        free(table->buckets[i]);
+    }
+    free(table->buckets);
+    free(table);
+}
+
+/*------------------------------- Benchmark -------------------------------------------*/
+
+// the four measurements of a table, in ns per operation
+typedef struct Result
+{
+    double insert;
+    double hit;
+    double miss;
+    double remove;
+} Result;
+
+static Result benchOld(char **keys, char **misses, int count, long lookups)
+{
+    Result result;
+    OldTable *table = oldCreate(101);
+    volatile long found = 0;
+
+    double start = benchNow();
+    for (int i = 0; i < count; i++)
+        oldSet(table, keys[i], "ls -l --color=auto");
+    result.insert = (benchNow() - start) / count * 1e9;
+
+    start = benchNow();
+    for (long i = 0; i < lookups; i++)
+        found += oldGet(table, keys[i % count]) != NULL;
+    result.hit = (benchNow() - start) / lookups * 1e9;
+
+    start = benchNow();
+    for (long i = 0; i < lookups; i++)
+        found += oldGet(table, misses[i % count]) != NULL;
+    result.miss = (benchNow() - start) / lookups * 1e9;
+
+    // the old unalias only emptied the value, the node stayed in its chain
+    start = benchNow();
+    for (int i = 0; i < count; i++)
+        oldSet(table, keys[i], NULL);
+    result.remove = (benchNow() - start) / count * 1e9;
+
+    oldDelete(table);
+    return result;
+}
+
+static Result benchNew(char **keys, char **misses, int count, long lookups)
+{
+    Result result;
+    hashtable *table = createHashtable(HASHTABLE_INITIAL_CAPACITY);
+    volatile long found = 0;
+
+    double start = benchNow();
+    for (int i = 0; i < count; i++)
+        set(table, keys[i], "ls -l --color=auto");
+    result.insert = (benchNow() - start) / count * 1e9;
+
+    start = benchNow();
+    for (long i = 0; i < lookups; i++)
+        found += get(table, keys[i % count]) != NULL;
+    result.hit = (benchNow() - start) / lookups * 1e9;
+
+    start = benchNow();
+    for (long i = 0; i < lookups; i++)
+        found += get(table, misses[i % count]) != NULL;
+    result.miss = (benchNow() - start) / lookups * 1e9;
+
+    start = benchNow();
+    for (int i = 0; i < count; i++)
+        removeKey(table, keys[i]);
+    result.remove = (benchNow() - start) / count * 1e9;
+
+    deleteHashtable(table);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    long lookups = benchOption(argc, argv, "-n", 2000000);
+    int sizes[] = {10, 1000, 100000};
+
+    printf("alias_table: %ld lookups per measurement, ns per operation (old chained / open addressing)\n", lookups);
+
+    for (unsigned long s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int count = sizes[s];
+
+        // the aliases, and command names that aren't aliases. some of the names are too long to be stored inline
+        char **keys = malloc(count * sizeof(char *));
+        char **misses = malloc(count * sizeof(char *));
+        for (int i = 0; i < count; i++)
+        {
+            char name[64];
+            snprintf(name, sizeof(name), i % 4 ? "alias%d" : "a_rather_long_alias_name_%d", i);
+            keys[i] = strdup(name);
+            snprintf(name, sizeof(name), "command%d", i);
+            misses[i] = strdup(name);
+        }
+
+        Result old = benchOld(keys, misses, count, lookups);
+        Result new = benchNew(keys, misses, count, lookups);
+
+        printf("%d aliases\n", count);
+        BENCH_ROW("insert", "%10.1f / %-10.1f", old.insert, new.insert);
+        BENCH_ROW("lookup, hit", "%10.1f / %-10.1f", old.hit, new.hit);
+        BENCH_ROW("lookup, miss", "%10.1f / %-10.1f", old.miss, new.miss);
+        BENCH_ROW("unalias", "%10.1f / %-10.1f", old.remove, new.remove);
+
+        for (int i = 0; i < count; i++)
+        {
+            free(keys[i]);
+            free(misses[i]);
+        }
+        free(keys);
+        free(misses);
+    }
+
+    return 0;
+}
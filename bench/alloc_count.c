@@ -0,0 +1,136 @@
+/**
+ * @file alloc_count.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Counts the heap allocations made while parsing the lines of the test corpus into command chains, i.e. the work the main loop does for every line before executing it. malloc and friends are interposed to count the calls.
+ *
+ * Only lexing and parsing are measured. Aliases and wildcards are expanded when a command is executed, which is not part of this benchmark.
+ *
+ * Usage: bench_alloc_count [corpus directory, default test/Tests] [-r rounds]
+ * @version 0.1
+ * @date 2023-07-20
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "bench.h"
+#include "parser.h"
+#include "hashtable.h"
+
+#include <dirent.h>
+
+// the globals of main.c, which the parser and the builtins refer to
+hashtable *aliases = NULL;
+FILE *script = NULL;
+int mode = 0;
+
+// the allocator behind the interposed functions
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *memory, size_t size);
+extern void __libc_free(void *memory);
+
+static long allocations = 0;
+
+void *malloc(size_t size)
+{
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *memory, size_t size)
+{
+    allocations++;
+    return __libc_realloc(memory, size);
+}
+
+void free(void *memory)
+{
+    __libc_free(memory);
+}
+
+int main(int argc, char **argv)
+{
+    const char *corpus = argc > 1 && argv[1][0] != '-' ? argv[1] : "test/Tests";
+    long rounds = benchOption(argc, argv, "-r", 100);
+
+    // read the corpus up front, so that reading it isn't counted
+    DIR *dir = opendir(corpus);
+    if (!dir)
+    {
+        perror(corpus);
+        return 1;
+    }
+
+    char **lines = NULL;
+    long nLines = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)))
+    {
+        size_t length = strlen(entry->d_name);
+        int isTest = (length > 5 && strcmp(entry->d_name + length - 5, ".test") == 0) || (length > 7 && strcmp(entry->d_name + length - 7, ".hidden") == 0);
+        if (!isTest)
+            continue;
+
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", corpus, entry->d_name);
+        FILE *file = fopen(path, "r");
+        if (!file)
+            continue;
+
+        LineBuffer buffer = {NULL, 0};
+        while (readLine(file, &buffer) != -1)
+        {
+            if (buffer.data[0] == '\0')
+                continue;
+            lines = realloc(lines, (nLines + 1) * sizeof(char *));
+            lines[nLines++] = strdup(buffer.data);
+        }
+        freeLineBuffer(&buffer);
+        fclose(file);
+    }
+    closedir(dir);
+
+    aliases = createHashtable(HASHTABLE_INITIAL_CAPACITY);
+    TokenList tokens = {NULL, 0, NULL, 0, NULL};
+    Arena arena;
+    initArena(&arena, ARENA_BLOCK_SIZE);
+
+    long parsed = 0;
+    long before = allocations;
+    double start = benchNow();
+    for (long round = 0; round < rounds; round++)
+    {
+        for (long i = 0; i < nLines; i++)
+        {
+            if (tokenize(lines[i], &tokens))
+                continue;
+
+            parseTokens(&tokens, &arena);
+            resetArena(&arena);
+            parsed++;
+        }
+    }
+    double elapsed = benchNow() - start;
+    long counted = allocations - before;
+
+    printf("alloc_count: %ld lines of %s, parsed %ld times\n", nLines, corpus, rounds);
+    BENCH_ROW("allocations", "%12ld", counted);
+    BENCH_ROW("allocations per line", "%12.2f", parsed ? (double)counted / parsed : 0.0);
+    BENCH_ROW("ns per line", "%12.0f", parsed ? elapsed * 1e9 / parsed : 0.0);
+
+    destroyArena(&arena);
+    freeTokenList(&tokens);
+    deleteHashtable(aliases);
+    for (long i = 0; i < nLines; i++)
+        free(lines[i]);
+    free(lines);
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file bench.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Small helpers shared by the benchmarks in the bench directory. Each benchmark is a standalone program, built by `make bench`.
+ * @version 0.1
+ * @date 2023-07-12
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// prints a row of a result table, with the name left aligned
+#define BENCH_ROW(name, fmt, ...) printf("  %-36s" fmt "\n", name, __VA_ARGS__)
+
+/**
+ * @brief Returns a monotonic timestamp in seconds.
+ *
+ * @return double Seconds since an arbitrary point
+ */
+static inline double benchNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Reads an integer option of the form `-x value` from the command line, or returns the default.
+ *
+ * @param argc Argument count
+ * @param argv Arguments
+ * @param option The option, e.g. "-n"
+ * @param fallback The default value
+ * @return long The value of the option
+ */
+static inline long benchOption(int argc, char** argv, const char* option, long fallback)
+{
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (argv[i][0] == option[0] && argv[i][1] == option[1] && argv[i][2] == '\0')
+            return atol(argv[i + 1]);
+    }
+    return fallback;
+}
+
+#endif // BENCH_H
@@ -0,0 +1,103 @@
+/**
+ * @file builtin_output.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Cost of running `echo` into a file, with the old output path (dup the descriptor onto stdout, printf, fflush, restore stdout) and with the output sink the builtins use now, which writes straight to the descriptor.
+ *
+ * Usage: bench_builtin_output [-n invocations]
+ * @version 0.1
+ * @date 2023-07-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "bench.h"
+#include "shell_builtins.h"
+#include "hashtable.h"
+
+#include <errno.h>
+#include <fcntl.h>
+
+// the globals of main.c, which the builtins refer to
+hashtable *aliases = NULL;
+FILE *script = NULL;
+int mode = 0;
+
+// the old echo, along with the descriptor juggling it did around every call
+static int oldEcho(SimpleCommand *simpleCommand)
+{
+    int savedStdout = STDOUT_FD;
+    if (simpleCommand->outputFD != STDOUT_FD)
+    {
+        savedStdout = dup(STDOUT_FD);
+        if (dup2(simpleCommand->outputFD, STDOUT_FD) == -1)
+            return -1;
+    }
+
+    for (int i = 1; i < simpleCommand->argc - 1; i++)
+    {
+        printf("%s ", simpleCommand->args[i]);
+    }
+    printf("%s\n", simpleCommand->args[simpleCommand->argc - 1]);
+    fflush(stdout);
+
+    if (savedStdout != STDOUT_FD)
+    {
+        dup2(savedStdout, STDOUT_FD);
+        close(savedStdout);
+    }
+
+    return 0;
+}
+
+static double run(ExecutionFunction function, SimpleCommand *simpleCommand, const char *path, long n)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+    {
+        perror(path);
+        exit(1);
+    }
+    simpleCommand->outputFD = fd;
+
+    double start = benchNow();
+    for (long i = 0; i < n; i++)
+        function(simpleCommand);
+    double elapsed = benchNow() - start;
+
+    close(fd);
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    long n = benchOption(argc, argv, "-n", 1000000);
+
+    char path[] = "/tmp/bench_echo_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1)
+    {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    Arena arena;
+    initArena(&arena, ARENA_BLOCK_SIZE);
+    SimpleCommand *simpleCommand = initSimpleCommand(&arena);
+    pushArgs(&arena, "echo", simpleCommand);
+    pushArgs(&arena, "hello", simpleCommand);
+    pushArgs(&arena, "world", simpleCommand);
+
+    double old = run(oldEcho, simpleCommand, path, n);
+    double sink = run(echo, simpleCommand, path, n);
+
+    printf("builtin_output: %ld echo invocations into a file\n", n);
+    printf("  %-36s%12s%12s\n", "path", "seconds", "ns/call");
+    BENCH_ROW("dup2 + printf + fflush", "%12.3f%12.0f", old, old * 1e9 / n);
+    BENCH_ROW("output sink", "%12.3f%12.0f", sink, sink * 1e9 / n);
+
+    destroyArena(&arena);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file dispatch.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Cost of looking up a command name in registries of growing size, with a linear strcmp scan (the old getExecutionFunction) and with the perfect hash dispatch table. Most lookups in a script are misses (external commands), which are the worst case of the scan.
+ *
+ * Usage: bench_dispatch [-n lookups]
+ * @version 0.1
+ * @date 2023-07-14
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "bench.h"
+#include "dispatch.h"
+
+static int dummy(SimpleCommand *command)
+{
+    (void)command;
+    return 0;
+}
+
+// the old lookup
+static ExecutionFunction linearLookup(const CommandRegistry *registry, const char *name)
+{
+    for (int i = 0; registry[i].commandName != NULL; i++)
+    {
+        if (strcmp(registry[i].commandName, name) == 0)
+            return registry[i].executionFunction;
+    }
+    return NULL;
+}
+
+static ExecutionFunction hashedLookup(const DispatchTable *table, const char *name)
+{
+    const CommandRegistry *entry = lookupDispatchTable(table, name);
+    return entry ? entry->executionFunction : NULL;
+}
+
+int main(int argc, char **argv)
+{
+    long n = benchOption(argc, argv, "-n", 2000000);
+    int sizes[] = {8, 32, 128, 512};
+
+    // the words looked up: some builtins, and a lot of external commands
+    const char *queries[] = {"echo", "cd", "ls", "grep", "awk", "sed", "cat", "sort", "builtin_5", "wc"};
+    int nQueries = sizeof(queries) / sizeof(queries[0]);
+
+    printf("dispatch: %ld lookups per measurement, ns per lookup\n", n);
+    printf("  %-36s%12s%12s\n", "registry size", "linear", "perfect");
+
+    for (unsigned long s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int size = sizes[s];
+        CommandRegistry *registry = calloc(size + 1, sizeof(CommandRegistry));
+        char (*names)[32] = calloc(size, 32);
+
+        const char *real[] = {"cd", "pwd", "echo", "exit", "alias", "unalias", "history", "jobs"};
+        for (int i = 0; i < size; i++)
+        {
+            if (i < 8)
+                snprintf(names[i], 32, "%s", real[i]);
+            else
+                snprintf(names[i], 32, "builtin_%d", i);
+            registry[i].commandName = names[i];
+            registry[i].executionFunction = dummy;
+        }
+
+        DispatchTable table;
+        buildDispatchTable(&table, registry);
+
+        // the results are summed up so the lookups can't be optimized away
+        volatile long found = 0;
+
+        double start = benchNow();
+        for (long i = 0; i < n; i++)
+            found += linearLookup(registry, queries[i % nQueries]) != NULL;
+        double linear = (benchNow() - start) / n * 1e9;
+
+        start = benchNow();
+        for (long i = 0; i < n; i++)
+            found += hashedLookup(&table, queries[i % nQueries]) != NULL;
+        double perfect = (benchNow() - start) / n * 1e9;
+
+        char label[32];
+        snprintf(label, sizeof(label), "%d builtins", size);
+        printf("  %-36s%12.1f%12.1f\n", label, linear, perfect);
+
+        freeDispatchTable(&table);
+        free(registry);
+        free(names);
+    }
+
+    return 0;
+}
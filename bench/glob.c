@@ -0,0 +1,101 @@
+/**
+ * @file glob.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Cost of expanding words with libc glob (GLOB_NOCHECK | GLOB_TILDE, what the shell used before) and with the shell's own engine: a plain word without wildcards, and `*.log` in a big directory expanded over and over, like a script that loops over the same logs. The directory is created under /tmp and removed afterwards.
+ *
+ * Usage: bench_glob [-f files in the directory] [-r expansions]
+ * @version 0.1
+ * @date 2023-07-28
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "bench.h"
+#include "wildcard.h"
+
+#include <glob.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static double benchLibc(const char *word, long rounds, size_t *count)
+{
+    double start = benchNow();
+    for (long i = 0; i < rounds; i++)
+    {
+        glob_t globbuf;
+        glob(word, GLOB_NOCHECK | GLOB_TILDE, NULL, &globbuf);
+        *count = globbuf.gl_pathc;
+        globfree(&globbuf);
+    }
+    return (benchNow() - start) / rounds * 1e9;
+}
+
+static double benchEngine(const char *word, long rounds, size_t *count)
+{
+    double start = benchNow();
+    for (long i = 0; i < rounds; i++)
+    {
+        GlobMatches matches;
+        expandGlob(word, &matches);
+        *count = matches.count;
+        freeGlobMatches(&matches);
+    }
+    return (benchNow() - start) / rounds * 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    long files = benchOption(argc, argv, "-f", 20000);
+    long rounds = benchOption(argc, argv, "-r", 200);
+
+    char dir[] = "/tmp/bench_glob_XXXXXX";
+    if (!mkdtemp(dir))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    // half of the files are logs
+    char path[4096];
+    for (long i = 0; i < files; i++)
+    {
+        snprintf(path, sizeof(path), "%s/file%ld.%s", dir, i, i % 2 ? "log" : "txt");
+        int fd = open(path, O_CREAT | O_WRONLY, 0644);
+        if (fd != -1)
+            close(fd);
+    }
+
+    // the listing is only reused once the directory has been left alone for a while, like the logs of an earlier run
+    struct timespec old[2] = {{time(NULL) - 60, 0}, {time(NULL) - 60, 0}};
+    utimensat(AT_FDCWD, dir, old, 0);
+
+    char pattern[4096];
+    snprintf(pattern, sizeof(pattern), "%s/*.log", dir);
+
+    size_t libcCount, engineCount;
+    printf("glob: %ld files, ns per expansion\n", files);
+    printf("  %-36s%14s%14s\n", "word", "libc", "engine");
+
+    double libc = benchLibc("plainword", rounds * 1000, &libcCount);
+    double engine = benchEngine("plainword", rounds * 1000, &engineCount);
+    printf("  %-36s%14.0f%14.0f\n", "plainword", libc, engine);
+
+    libc = benchLibc(pattern, rounds, &libcCount);
+    engine = benchEngine(pattern, rounds, &engineCount);
+    printf("  %-36s%14.0f%14.0f\n", "<dir>/*.log", libc, engine);
+    BENCH_ROW("matches (libc / engine)", "%zu / %zu", libcCount, engineCount);
+
+    clearDirectoryCache();
+    for (long i = 0; i < files; i++)
+    {
+        snprintf(path, sizeof(path), "%s/file%ld.%s", dir, i, i % 2 ? "log" : "txt");
+        unlink(path);
+    }
+    rmdir(dir);
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file glob_recursive.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Cost of walking a synthetic tree for a recursive `**` pattern, with the walk split over a growing number of threads, and of expanding a `**` pattern for the C files of the tree as a whole (the walk, matching and sorting). Every walk is checked against the serial one, the entries have to come out in the same order. The tree is created under /tmp and removed afterwards, and is in the page cache while it is walked.
+ *
+ * Usage: bench_glob_recursive [-f files in the tree, default 500000] [-r rounds]
+ * @version 0.1
+ * @date 2023-07-29
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#define _GNU_SOURCE  // for nftw's FTW_PHYS
+
+#include "bench.h"
+#include "walk.h"
+#include "wildcard.h"
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// shape of the tree: 20 top level directories, with 10 under each, with 25 under each, and the files spread over those
+#define LEVEL1 20
+#define LEVEL2 10
+#define LEVEL3 25
+
+static int removeEntry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+static void createTree(const char *root, long files)
+{
+    long leaves = LEVEL1 * LEVEL2 * LEVEL3;
+    long perLeaf = files / leaves;
+    char path[4096];
+
+    for (int a = 0; a < LEVEL1; a++)
+    {
+        snprintf(path, sizeof(path), "%s/dir%d", root, a);
+        mkdir(path, 0755);
+        for (int b = 0; b < LEVEL2; b++)
+        {
+            snprintf(path, sizeof(path), "%s/dir%d/sub%d", root, a, b);
+            mkdir(path, 0755);
+            for (int c = 0; c < LEVEL3; c++)
+            {
+                snprintf(path, sizeof(path), "%s/dir%d/sub%d/leaf%d", root, a, b, c);
+                mkdir(path, 0755);
+                int dirFD = open(path, O_RDONLY | O_DIRECTORY);
+                for (long f = 0; f < perLeaf; f++)
+                {
+                    char name[64];
+                    // a fifth of the files are C sources
+                    snprintf(name, sizeof(name), "file%ld.%s", f, f % 5 ? "o" : "c");
+                    int fd = openat(dirFD, name, O_CREAT | O_WRONLY, 0644);
+                    if (fd != -1)
+                        close(fd);
+                }
+                close(dirFD);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long files = benchOption(argc, argv, "-f", 500000);
+    long rounds = benchOption(argc, argv, "-r", 3);
+
+    char root[] = "/tmp/bench_glob_recursive_XXXXXX";
+    if (!mkdtemp(root))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    printf("glob_recursive: creating a tree of %ld files\n", files);
+    createTree(root, files);
+
+    // the serial walk, which the parallel ones have to agree with
+    WalkResult serial;
+    walkTree(root, 1, &serial);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("  %ld entries, %ld online cpus, ms per walk\n", (long)serial.count, cpus);
+
+    for (int threads = 1; threads <= 16 && threads <= (cpus > 0 ? cpus : 1) * 2; threads *= 2)
+    {
+        double best = 0;
+        bool same = true;
+        for (long r = 0; r < rounds; r++)
+        {
+            WalkResult result;
+            double start = benchNow();
+            walkTree(root, threads, &result);
+            double elapsed = benchNow() - start;
+            if (r == 0 || elapsed < best)
+                best = elapsed;
+
+            same &= result.count == serial.count;
+            for (size_t i = 0; same && i < result.count; i++)
+                same &= strcmp(result.entries[i].path, serial.entries[i].path) == 0;
+            freeWalkResult(&result);
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "walk, %d thread%s", threads, threads > 1 ? "s" : "");
+        BENCH_ROW(name, "%12.1f%s", best * 1e3, same ? "" : "  (differs from the serial walk)");
+    }
+    freeWalkResult(&serial);
+
+    char pattern[4096];
+    snprintf(pattern, sizeof(pattern), "%s/**/*.c", root);
+
+    double best = 0;
+    size_t count = 0;
+    for (long r = 0; r < rounds; r++)
+    {
+        GlobMatches matches;
+        double start = benchNow();
+        expandGlob(pattern, &matches);
+        double elapsed = benchNow() - start;
+        if (r == 0 || elapsed < best)
+            best = elapsed;
+        count = matches.count;
+        freeGlobMatches(&matches);
+    }
+    BENCH_ROW("expand <tree>/**/*.c", "%12.1f", best * 1e3);
+    BENCH_ROW("matches", "%12zu", count);
+
+    nftw(root, removeEntry, 64, FTW_DEPTH | FTW_PHYS);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file spawn.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Spawns per second of fork+exec, vfork+exec and posix_spawn, with the parent holding different amounts of resident memory. fork has to copy the parent's page tables, so its cost grows with the shell's size, the other two don't.
+ *
+ * Usage: bench_spawn [-n spawns] [-m megabytes]. Without -m, runs at 0, 64 and 512 MiB.
+ * @version 0.1
+ * @date 2023-07-12
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "bench.h"
+
+#include <spawn.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+static char* const childArgs[] = {"/bin/true", NULL};
+
+static int spawnFork(void)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execve(childArgs[0], childArgs, environ);
+        _exit(127);
+    }
+    return pid;
+}
+
+static int spawnVfork(void)
+{
+    pid_t pid = vfork();
+    if (pid == 0)
+    {
+        execve(childArgs[0], childArgs, environ);
+        _exit(127);
+    }
+    return pid;
+}
+
+static int spawnPosix(void)
+{
+    pid_t pid;
+    if (posix_spawn(&pid, childArgs[0], NULL, NULL, childArgs, environ) != 0)
+        return -1;
+    return pid;
+}
+
+// runs n spawn+wait cycles, returns spawns per second
+static double measure(int (*spawnFunction)(void), long n)
+{
+    double start = benchNow();
+    for (long i = 0; i < n; i++)
+    {
+        int pid = spawnFunction();
+        if (pid == -1)
+        {
+            perror("spawn");
+            exit(1);
+        }
+        waitpid(pid, NULL, 0);
+    }
+    return n / (benchNow() - start);
+}
+
+int main(int argc, char** argv)
+{
+    long n = benchOption(argc, argv, "-n", 2000);
+    long sizes[] = {0, 64, 512};
+    int nSizes = 3;
+
+    long megabytes = benchOption(argc, argv, "-m", -1);
+    if (megabytes >= 0)
+    {
+        sizes[0] = megabytes;
+        nSizes = 1;
+    }
+
+    printf("spawn: %ld spawns of %s per measurement\n", n, childArgs[0]);
+
+    char* ballast = NULL;
+    for (int i = 0; i < nSizes; i++)
+    {
+        // touch every page, so that they're really resident and mapped
+        free(ballast);
+        ballast = sizes[i] ? malloc(sizes[i] << 20) : NULL;
+        if (ballast)
+            memset(ballast, 1, sizes[i] << 20);
+
+        printf("resident ballast: %ld MiB\n", sizes[i]);
+        BENCH_ROW("fork + execve", "%10.0f spawns/s", measure(spawnFork, n));
+        BENCH_ROW("vfork + execve", "%10.0f spawns/s", measure(spawnVfork, n));
+        BENCH_ROW("posix_spawn", "%10.0f spawns/s", measure(spawnPosix, n));
+    }
+    free(ballast);
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file spawn_server.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Latency of starting (and reaping) a process with fork+exec, with posix_spawn, and through the spawn server, with the parent holding different amounts of resident memory. The server is started before the memory is allocated, like the shell starts it before anything else.
+ *
+ * Usage: bench_spawn_server [-n spawns] [-m megabytes]. Without -m, runs at 0, 64 and 512 MiB.
+ * @version 0.1
+ * @date 2023-07-31
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "bench.h"
+#include "spawn_server.h"
+
+#include <spawn.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+static char* childArgs[] = {"/bin/true", NULL};
+
+static int spawnFork(void)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execve(childArgs[0], childArgs, environ);
+        _exit(127);
+    }
+    return pid;
+}
+
+static int spawnPosix(void)
+{
+    pid_t pid;
+    if (posix_spawn(&pid, childArgs[0], NULL, NULL, childArgs, environ) != 0)
+        return -1;
+    return pid;
+}
+
+static int spawnServer(void)
+{
+    SpawnRequest request = {childArgs[0], childArgs, environ, STDIN_FILENO, STDOUT_FILENO, false, 0, -1};
+    pid_t pid;
+    if (requestSpawn(&request, &pid) != 0)
+        return -1;
+    return pid;
+}
+
+// runs n spawn+wait cycles, returns microseconds per cycle
+static double measure(int (*spawnFunction)(void), long n)
+{
+    double start = benchNow();
+    for (long i = 0; i < n; i++)
+    {
+        int pid = spawnFunction();
+        if (pid == -1)
+        {
+            perror("spawn");
+            exit(1);
+        }
+        waitpid(pid, NULL, 0);
+    }
+    return (benchNow() - start) / n * 1e6;
+}
+
+int main(int argc, char** argv)
+{
+    long n = benchOption(argc, argv, "-n", 2000);
+    long sizes[] = {0, 64, 512};
+    int nSizes = 3;
+
+    long megabytes = benchOption(argc, argv, "-m", -1);
+    if (megabytes >= 0)
+    {
+        sizes[0] = megabytes;
+        nSizes = 1;
+    }
+
+    if (startSpawnServer())
+    {
+        perror("startSpawnServer");
+        return 1;
+    }
+
+    printf("spawn_server: %ld spawns of %s per measurement, us per spawn and wait\n", n, childArgs[0]);
+
+    char* ballast = NULL;
+    for (int i = 0; i < nSizes; i++)
+    {
+        // touch every page, so that they're really resident and mapped
+        free(ballast);
+        ballast = sizes[i] ? malloc(sizes[i] << 20) : NULL;
+        if (ballast)
+            memset(ballast, 1, sizes[i] << 20);
+
+        printf("resident ballast: %ld MiB\n", sizes[i]);
+        BENCH_ROW("fork + execve", "%10.1f", measure(spawnFork, n));
+        BENCH_ROW("posix_spawn", "%10.1f", measure(spawnPosix, n));
+        BENCH_ROW("spawn server", "%10.1f", measure(spawnServer, n));
+    }
+    free(ballast);
+
+    stopSpawnServer();
+    return 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file stdin_reader.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Cost of reading the lines of a non-interactive shell's stdin: through stdio (what the shell did before, which reads ahead of the line and leaves nothing of it for the commands), with the input reader from a file (block reads), and with the input reader from a pipe (byte reads). The file is created under /tmp and removed afterwards.
+ *
+ * Usage: bench_stdin_reader [-n lines]
+ * @version 0.1
+ * @date 2023-07-30
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "bench.h"
+#include "input.h"
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define LINE "echo the quick brown fox jumps over the lazy dog\n"
+
+static double benchStdio(const char *path, long *count)
+{
+    FILE *file = fopen(path, "r");
+    LineBuffer line = {NULL, 0};
+
+    double start = benchNow();
+    for (*count = 0; readLine(file, &line) != -1; (*count)++)
+        ;
+    double elapsed = benchNow() - start;
+
+    freeLineBuffer(&line);
+    fclose(file);
+    return elapsed;
+}
+
+static double benchReader(int fd, long *count)
+{
+    LineBuffer line = {NULL, 0};
+    initInput(fd);
+
+    double start = benchNow();
+    for (*count = 0; readInputLine(&line) != -1; (*count)++)
+        ;
+    double elapsed = benchNow() - start;
+
+    freeLineBuffer(&line);
+    freeInput();
+    return elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    long lines = benchOption(argc, argv, "-n", 200000);
+
+    char path[] = "/tmp/bench_stdin_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1)
+    {
+        perror("mkstemp");
+        return 1;
+    }
+    for (long i = 0; i < lines; i++)
+    {
+        if (write(fd, LINE, sizeof(LINE) - 1) == -1)
+            break;
+    }
+    close(fd);
+
+    long count;
+    printf("stdin_reader: %ld lines, ns per line\n", lines);
+
+    double elapsed = benchStdio(path, &count);
+    BENCH_ROW("stdio (reads ahead)", "%14.0f  (%ld lines)", elapsed / lines * 1e9, count);
+
+    fd = open(path, O_RDONLY);
+    elapsed = benchReader(fd, &count);
+    close(fd);
+    BENCH_ROW("reader, file", "%14.0f  (%ld lines)", elapsed / lines * 1e9, count);
+
+    // a child writes the file into the pipe
+    int pipeFDs[2];
+    if (pipe(pipeFDs) == -1)
+    {
+        perror("pipe");
+        return 1;
+    }
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(pipeFDs[0]);
+        dup2(pipeFDs[1], STDOUT_FILENO);
+        execlp("cat", "cat", path, (char *)NULL);
+        _exit(127);
+    }
+    close(pipeFDs[1]);
+    elapsed = benchReader(pipeFDs[0], &count);
+    close(pipeFDs[0]);
+    waitpid(pid, NULL, 0);
+    BENCH_ROW("reader, pipe", "%14.0f  (%ld lines)", elapsed / lines * 1e9, count);
+
+    unlink(path);
+    return 0;
+}
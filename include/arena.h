@@ -0,0 +1,95 @@
+/**
+ * @file arena.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief A bump allocator for memory that dies all at once. Everything built for one line of input (the command chain, its commands, simple commands and their args) is allocated from an arena, and freed together by resetting it once the line has been executed.
+ * @version 0.1
+ * @date 2023-07-20
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "utils.h"
+
+#include <stddef.h>
+
+// size of the first block of an arena. a line that needs more gets extra blocks, which are given back on reset
+#define ARENA_BLOCK_SIZE 4096
+
+/**
+ * @brief A block of memory that allocations are carved from. Blocks are chained, the newest one first.
+ *
+ */
+typedef struct ArenaBlock
+{
+    struct ArenaBlock* next;    //< the previous (older) block
+    size_t size;                //< usable size of the block
+    size_t used;                //< bytes handed out from the block
+    max_align_t data[];         //< the memory itself
+} ArenaBlock;
+
+/**
+ * @brief The struct represents an arena.
+ *
+ */
+typedef struct Arena
+{
+    ArenaBlock* blocks;     //< the block allocations are currently carved from, followed by the older ones
+    size_t blockSize;       //< size of the first block
+} Arena;
+
+/**
+ * @brief Initializes an empty arena. No memory is allocated until the first allocation.
+ *
+ * @param arena The arena to initialize
+ * @param blockSize Size of the first block
+ */
+void initArena(Arena* arena, size_t blockSize);
+
+/**
+ * @brief Allocates memory from the arena, aligned for any type. The memory is valid until the arena is reset.
+ *
+ * @param arena The arena to allocate from
+ * @param size Number of bytes
+ * @return void* The memory, or NULL on failure
+ */
+void* arenaAlloc(Arena* arena, size_t size);
+
+/**
+ * @brief Grows an allocation. If it is the most recent allocation of the arena and there's room behind it, it grows in place, otherwise it is copied.
+ *
+ * @param arena The arena the allocation came from
+ * @param memory The allocation, NULL behaves like arenaAlloc
+ * @param oldSize The current size of the allocation
+ * @param newSize The new size
+ * @return void* The grown allocation, or NULL on failure
+ */
+void* arenaRealloc(Arena* arena, void* memory, size_t oldSize, size_t newSize);
+
+/**
+ * @brief Copies a string into the arena.
+ *
+ * @param arena The arena to allocate from
+ * @param str The string to copy, may be NULL
+ * @return char* The copy, or NULL
+ */
+char* arenaStrdup(Arena* arena, const char* str);
+
+/**
+ * @brief Frees everything allocated from the arena in one go. The first block is kept for the next use.
+ *
+ * @param arena The arena to reset
+ */
+void resetArena(Arena* arena);
+
+/**
+ * @brief Frees all the memory of the arena.
+ *
+ * @param arena The arena to destroy
+ */
+void destroyArena(Arena* arena);
+
+#endif // ARENA_H
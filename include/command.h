@@ -14,30 +14,65 @@
 
 // Includes
 #include "utils.h"
+#include "arena.h"
 #include <stdbool.h>
 #include <unistd.h>
 
+/**
+ * @brief A word of a simple command, as it was parsed.
+ * 
+ */
+typedef struct Word {
+    char* text;        //< the word, with its quotes removed
+    unsigned flags;    //< TOKEN_* flags of the word, e.g. whether it was quoted
+} Word;
+
 /**
  * @brief This struct represents a simple command.
  * 
- * A simple command is a command/process with its args and its set of file descriptors. Different simple commands can be combined together by pipes to form a pipeline. For example, `ls -l` is a simple command, while `ls -l | grep a` is not a simple command.
+ * A simple command is a command/process with its args and its set of file descriptors. The parser only records its words and redirections, which don't change from one execution to the next. Aliases, parameters and wildcards are expanded into the args when the simple command is executed. Different simple commands can be combined together by pipes to form a pipeline. For example, `ls -l` is a simple command, while `ls -l | grep a` is not a simple command.
  * 
- * IO redirection is handled by the shell, not by the command itself. So, the command will just have the file descriptors, and the shell will handle the redirection.
+ * IO redirection is handled by the shell, not by the command itself. The parser only records the files a simple command is redirected to/from. The executor opens them (and the pipes between the simple commands of a pipeline) right before the simple command is started, so that commands that are never run don't open anything.
  * 
  */
 typedef struct SimpleCommand {
-    char* commandName; //< cmd name, e.g. ls etc.
+    Word* words;       //< the words as parsed, before alias and wildcard expansion. they're what a compiled script stores
+    int nWords;        //< number of words
+    int wordsCapacity; //< number of slots allocated for the words array
 
-    char** args;       //< args array, including the command name
+    char* commandName; //< cmd name, e.g. ls etc. set when the words are expanded
+
+    char** assignments; //< the `name=value` words before the command name, expanded. set when the words are expanded
+    int nAssignments;   //< number of assignments
+    char** environment; //< environment of the process, with the assignments in it. NULL when it is the shell's own environment
+
+    char** args;       //< args array, including the command name. built from the words by expanding them, right before the simple command is executed
     int argc;          //< args count, including the command name, so it's equal to the length of the args array
+    int capacity;      //< number of slots allocated for the args array, including the one for the NULL terminator
+
+    char* inputFile;   //< file the input is redirected from (`< file`), NULL if none
+    char* outputFile;  //< file the output is redirected to (`> file` or `>> file`), NULL if none
+    bool append;       //< whether the output file is appended to rather than truncated
 
-    int inputFD;       //< input file descriptor, default value is 0 (stdin)
-    int outputFD;      //< output file descriptor, default value is 1 (stdout)
+    int inputFD;       //< input file descriptor, set up by the executor from the pipe or the input file. default value is 0 (stdin)
+    int outputFD;      //< output file descriptor, set up by the executor from the pipe or the output file. default value is 1 (stdout)
     int pid;           //< represents the processID of the child process, in case of external. Default is -1.
+    struct Job* job;   //< the job the child process is started in, set by the executor. Default is NULL.
 
     int (*execute)(struct SimpleCommand*); //< function pointer to the function that will execute the simple command.
 } SimpleCommand;
 
+/**
+ * @brief The operators a command can be chained to the next one with.
+ * 
+ */
+typedef enum ChainOperator {
+    CHAIN_NONE,         //< the last command of a chain
+    CHAIN_SEQUENCE,     //< ; (or & which also sends the command to the background), the next command always runs
+    CHAIN_AND,          //< &&, the next command runs if this one succeeded
+    CHAIN_OR            //< ||, the next command runs if this one failed
+} ChainOperator;
+
 /**
  * @brief This struct represents a command, or more precisely a pipeline.
  * 
@@ -49,10 +84,11 @@ typedef struct SimpleCommand {
 typedef struct Command {
     struct SimpleCommand** simpleCommands;  //< array to hold simple commands
     int nSimpleCommands;                    //< number of commands
+    int capacity;                           //< number of slots allocated for the simple commands array
 
     bool background;                        //< flag for background execution
 
-    char* chainingOperator;                 //< what chaining operator is used to chain with the next command. can be ';'/'||'/'&&'
+    ChainOperator chainingOperator;         //< what chaining operator is used to chain with the next command
     struct Command* next;                   //< pointer to the next command in the chain
 } Command;
 
@@ -69,34 +105,74 @@ typedef struct Command {
 typedef struct CommandChain {
     struct Command* head;   //< pointer to the head of the command chain
     struct Command* tail;   //< pointer to the tail of the command chain
+
+    struct Instruction* program;    //< the chain compiled to instructions, which is what is executed. NULL until compileCommandChain is called
+    int programLength;              //< number of instructions
+    struct Command** commands;      //< the commands of the chain, indexed by the EXEC_PIPELINE instructions
 } CommandChain;
 
+/**
+ * @brief The opcodes of the instructions a command chain is compiled to.
+ * 
+ */
+typedef enum Opcode {
+    OP_EXEC_PIPELINE,   //< executes the command with index operand, its status becomes the current status
+    OP_JUMP_IF_FAIL,    //< jumps to the instruction operand if the current status is not 0 (the command after &&)
+    OP_JUMP_IF_OK,      //< jumps to the instruction operand if the current status is 0 (the command after ||)
+    OP_SEQ              //< a sequence point (the command after ;), execution just goes on
+} Opcode;
+
+/**
+ * @brief An instruction of a compiled command chain.
+ * 
+ * `a && b || c; d` is compiled to:
+ * ```
+ * 0: EXEC_PIPELINE 0
+ * 1: JUMP_IF_FAIL  3
+ * 2: EXEC_PIPELINE 1
+ * 3: JUMP_IF_OK    5
+ * 4: EXEC_PIPELINE 2
+ * 5: SEQ
+ * 6: EXEC_PIPELINE 3
+ * ```
+ * 
+ */
+typedef struct Instruction {
+    Opcode opcode;      //< what the instruction does
+    int operand;        //< index of the command for EXEC_PIPELINE, index of the target instruction for the jumps
+} Instruction;
+
 
 // Function declarations
 
 
 // ------------------------- Initializers --------------------------------
 
+// Everything a line of input is parsed into (the chain, its commands, their simple commands, args and strings) is allocated from a per-line arena. Nothing is freed individually, the whole line is freed at once by resetting the arena after it has been executed.
+
 /**
- * @brief This function creates an empty simple command, and returns a pointer to it. It returns NULL on failure. The caller is responsible for freeing the memory allocated by this function.
+ * @brief This function creates an empty simple command in the arena, and returns a pointer to it. It returns NULL on failure.
  * 
+ * @param arena The arena of the line being parsed
  * @return SimpleCommand* Pointer to the simple command
  */
-SimpleCommand* initSimpleCommand();
+SimpleCommand* initSimpleCommand(Arena* arena);
 
 /**
- * @brief This function creates an empty command, and returns a pointer to it. It returns NULL on failure. The caller is responsible for freeing the memory allocated by this function.
+ * @brief This function creates an empty command in the arena, and returns a pointer to it. It returns NULL on failure.
  * 
+ * @param arena The arena of the line being parsed
  * @return Command* Pointer to the command
  */
-Command* initCommand();
+Command* initCommand(Arena* arena);
 
 /**
- * @brief This function creates an empty command chain, and returns a pointer to it. It returns NULL on failure. The caller is responsible for freeing the memory allocated by this function.
+ * @brief This function creates an empty command chain in the arena, and returns a pointer to it. It returns NULL on failure.
  * 
+ * @param arena The arena of the line being parsed
  * @return CommandChain* Pointer to the command chain
  */
-CommandChain* initCommandChain();
+CommandChain* initCommandChain(Arena* arena);
 
 
 // ------------------------- Pushers --------------------------------
@@ -104,79 +180,113 @@ CommandChain* initCommandChain();
 /**
  * @brief This function pushes an argument to the args array of a simple command. It returns 0 on success, -1 on failure.
  * 
- * If the simpleCommand's name is not set, then it also sets the name of the simple command to the argument. Then it pushes to the args array, and increments the argc.
+ * If the simpleCommand's name is not set, then it also sets the name of the simple command to the argument. Then it pushes to the args array, and increments the argc. The argument is copied into the arena.
  * 
+ * @param arena The arena the simple command was allocated from
  * @param arg Name or argument to push
  * @param simpleCommand The simple command to push the argument to
  * @return int Status code (0 on success, -1 on failure)
  */
-int pushArgs(char* arg, SimpleCommand* simpleCommand);
+int pushArgs(Arena* arena, char* arg, SimpleCommand* simpleCommand);
 
 /**
- * @brief This function adds a command to the command chain. It returns 0 on success, -1 on failure.
+ * @brief This function pushes a batch of arguments to the args array of a simple command, e.g. the paths a wildcard expanded to. The array is grown once for the whole batch. It returns 0 on success, -1 on failure.
  * 
- * @param chain The command chain to add the command to
- * @param command The command to add to the chain
+ * @param arena The arena the simple command was allocated from
+ * @param args The arguments to push
+ * @param count Number of arguments
+ * @param simpleCommand The simple command to push the arguments to
  * @return int Status code (0 on success, -1 on failure)
  */
-int addCommandToChain(CommandChain* chain, Command* command);
+int pushArgsBulk(Arena* arena, char** args, int count, SimpleCommand* simpleCommand);
 
 /**
- * @brief This function adds a simpleCommand to a command.
+ * @brief This function makes sure the args array of a simple command has room for a number of additional arguments (and the NULL terminator). The array grows geometrically, so pushing n arguments one by one costs O(n) copying overall. It returns 0 on success, -1 on failure.
  * 
- * Uses realloc to increase the size of the simple commands array in the command, and adds the simple command to the array. Returns 0 on success, -1 on failure.
- * 
- * @param command The command to add the simple command to
- * @param simpleCommand The simple command to add to the command
+ * @param arena The arena the simple command was allocated from
+ * @param simpleCommand The simple command
+ * @param count Number of arguments to make room for
  * @return int Status code (0 on success, -1 on failure)
  */
-int addSimpleCommand(Command* command, SimpleCommand* simpleCommand);
+int reserveArgs(Arena* arena, SimpleCommand* simpleCommand, int count);
 
-// ------------------------- Cleaners --------------------------------
+/**
+ * @brief This function pushes a word to the words of a simple command. The word is copied into the arena. It returns 0 on success, -1 on failure.
+ * 
+ * @param arena The arena the simple command was allocated from
+ * @param text The word
+ * @param flags The TOKEN_* flags of the word
+ * @param simpleCommand The simple command to push the word to
+ * @return int Status code (0 on success, -1 on failure)
+ */
+int pushWord(Arena* arena, const char* text, unsigned flags, SimpleCommand* simpleCommand);
 
 /**
- * @brief The function is responsible for freeing up the memory allocated by a simple command. All the internal arrays and strings are freed, and the pointer is set to NULL.
+ * @brief This function adds a command to the command chain. It returns 0 on success, -1 on failure.
  * 
- * @param simpleCommand Pointer to the simpleCommand to be freed
+ * @param chain The command chain to add the command to
+ * @param command The command to add to the chain
+ * @return int Status code (0 on success, -1 on failure)
  */
-void cleanUpSimpleCommand(SimpleCommand* simpleCommand);
+int addCommandToChain(CommandChain* chain, Command* command);
 
 /**
- * @brief The function is responsible for freeing up the memory allocated by a command. All the internal arrays and strings are freed, and the pointer is set to NULL.
+ * @brief This function adds a simpleCommand to a command.
+ * 
+ * Grows the simple commands array of the command in the arena (doubling its capacity when it is full), and adds the simple command to the array. Returns 0 on success, -1 on failure.
  * 
- * @param command Pointer to the command to be freed
+ * @param arena The arena the command was allocated from
+ * @param command The command to add the simple command to
+ * @param simpleCommand The simple command to add to the command
+ * @return int Status code (0 on success, -1 on failure)
  */
-void cleanUpCommand(Command* command);
+int addSimpleCommand(Arena* arena, Command* command, SimpleCommand* simpleCommand);
+
+// ------------------------- Compile --------------------------------
 
 /**
- * @brief The function is responsible for freeing up the memory allocated by a command chain. All the linked list nodes are freed, and the pointer is set to NULL.
+ * @brief This function compiles a command chain into the instructions the executor runs. The instructions are allocated from the arena. It returns 0 on success, -1 on failure.
  * 
- * @param chain Pointer to the command chain to be freed
+ * @param arena The arena the chain was allocated from
+ * @param chain The chain to compile
+ * @return int Status code (0 on success, -1 on failure)
  */
-void cleanUpCommandChain(CommandChain* chain);
+int compileCommandChain(Arena* arena, CommandChain* chain);
 
 // ------------------------- Execute --------------------------------
 
 /**
  * @brief This function executes a chain of commands.
  * 
- * Function traverses the linked list, and calls executeCommand on each command. The rules for executing a command chain are:
+ * Function runs the chain's compiled instructions, calling executeCommand for each EXEC_PIPELINE. The rules for executing a command chain (which the instructions encode) are:
  * 1. If the chaining operator is ';', then execute all commands in the chain, and return the exit status of the last command.
  * 2. If the chaining operator is '&&', the immediate RHS is only executed if the last executed command succeeds. If the last executed command fails, then the RHS is not executed (skippped) and the chain traversal continues.
  * 3. If the chaining operator is '||', the immediate RHS is only executed if the last executed command fails. If the last executed command succeeds, then the RHS is not executed (skippped) and the chain traversal continues.
  * 
  * @param chain The command chain to execute
+ * @param arena The arena the expanded args are allocated from. They only need to live until the chain has been executed
+ * @param tail Whether the chain is the last input of the shell. Its last command is then executed in place of the shell (see executeCommand)
  * @return int Status code (exit status of the last command according to the rules above)
  */
-int executeCommandChain(CommandChain* chain);
+int executeCommandChain(CommandChain* chain, Arena* arena, bool tail);
 
 /**
- * @brief This function executes a command. The function traverses the simple commands in the command, and executes them one by one.
+ * @brief This function executes a command (pipeline).
+ * 
+ * Every stage of the pipeline is started before any of them is waited on, so the stages run concurrently and stream through their pipes. Once all stages have been started, the child processes are reaped together.
+ * 
+ * Builtins that are a stage of a pipeline with more than one stage, or that run in the background, are run in a forked child, so that they stream concurrently with the other stages. A builtin on its own runs in the shell process.
+ * 
+ * The pipes between the stages and the redirection files are opened here, close-on-exec, as each stage is started, and the shell closes its copies right after. A stage whose redirection can't be opened fails with status 1, without being run.
+ * 
+ * A command that is the last thing the shell does (tail is set), and is a single external command in the foreground, replaces the shell process instead of being started as its child. Nothing is left for the shell to wait for, so it saves a fork and a process.
  * 
  * @param command The command to execute
- * @return int Status code (exit status of the last command)
+ * @param arena The arena the expanded args are allocated from
+ * @param tail Whether nothing is executed after the command
+ * @return int Status code (exit status of the last stage of the pipeline). Doesn't return if the command replaced the shell
  */
-int executeCommand(Command* command);
+int executeCommand(Command* command, Arena* arena, bool tail);
 
 // ------------------------- Debug --------------------------------
 
@@ -0,0 +1,66 @@
+/**
+ * @file dispatch.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief A perfect hash table mapping builtin names to their execution functions, so that finding out whether a word is a builtin costs one hash and at most one string compare, no matter how many builtins there are.
+ * @version 0.1
+ * @date 2023-07-14
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "shell_builtins.h"
+
+/**
+ * @brief This struct represents the builtin commands of the shell, and their corresponding execution functions.
+ *
+ */
+typedef struct CommandRegistry
+{
+    const char *commandName;
+    ExecutionFunction executionFunction;
+} CommandRegistry;
+
+/**
+ * @brief The struct represents the perfect hash table built over a registry.
+ *
+ * The hash is seeded, and the seed is chosen such that no two registered names land in the same slot. A lookup is then a hash, a mask, and a single compare against the only name that could be in that slot.
+ *
+ */
+typedef struct DispatchTable
+{
+    const CommandRegistry **slots;      //< the table, NULL for empty slots. NULL if no seed was found, and the registry is scanned instead
+    unsigned long mask;                 //< table size - 1, the size is a power of two
+    unsigned long seed;                 //< the seed that makes the hash collision free for the registry
+    const CommandRegistry *registry;    //< the registry the table was built over
+} DispatchTable;
+
+/**
+ * @brief Builds the perfect hash table for a registry. Tries a bounded number of seeds until one maps every name to its own slot, doubling the table when none does. If no seed is found after a few doublings, lookups scan the registry instead.
+ *
+ * @param table The table to build
+ * @param registry The registry, terminated by an entry with a NULL name. Must outlive the table.
+ * @return int Status code (0 on success, -1 if a name is registered twice or on allocation failure)
+ */
+int buildDispatchTable(DispatchTable *table, const CommandRegistry *registry);
+
+/**
+ * @brief Looks up a name in the table.
+ *
+ * @param table The table
+ * @param name The name to look up
+ * @return const CommandRegistry* The registry entry, or NULL if the name isn't registered
+ */
+const CommandRegistry *lookupDispatchTable(const DispatchTable *table, const char *name);
+
+/**
+ * @brief Frees the memory used by the table.
+ *
+ * @param table The table
+ */
+void freeDispatchTable(DispatchTable *table);
+
+#endif // DISPATCH_H
@@ -0,0 +1,35 @@
+/**
+ * @file expand.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Word expansion. The parser keeps the words of a simple command as they were written, and they are expanded into the args right before the simple command runs: an alias in the command position is replaced by its value (recursively, with each alias expanded at most once per word), parameters (`$name`, `${name}`, `$?`, `$$`, `$!`) by their values, with the `${name-word}`, `${name=word}`, `${name+word}` and `${name?word}` forms (and their `:` variants, which treat an empty value like an unset one) using the word instead when the parameter is unset, or failing the command; any other `${...}` is a bad substitution, and wildcard patterns by the paths they match. The results of unquoted parameter expansions are split into fields on IFS. Quoted words are not matched against paths.
+ * @version 0.1
+ * @date 2023-07-24
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef EXPAND_H
+#define EXPAND_H
+
+#include "command.h"
+
+/**
+ * @brief Expands the words of a simple command into its args and assignments, and sets its command name, execution function and environment. Any args from an earlier expansion are discarded.
+ *
+ * @param arena The arena the args are allocated from
+ * @param simpleCommand The simple command to expand
+ * @return int Status code (0 on success, -1 on failure)
+ */
+int expandSimpleCommand(Arena* arena, SimpleCommand* simpleCommand);
+
+/**
+ * @brief Expands the parameters of a text that is a single field, like the value of an assignment or the file of a redirection.
+ *
+ * @param arena The arena the result is allocated from
+ * @param text The text, as the lexer wrote it
+ * @return char* The expanded text, which is the text itself if it has nothing to expand. NULL on failure
+ */
+char* expandString(Arena* arena, const char* text);
+
+#endif // EXPAND_H
@@ -1,7 +1,9 @@
 /**  
  * @file hashtable.h Hashtable implementation
  * @author Abdul Rafay (24100173@lums.edu.pk)
- * @brief Implementation of a hashtable to be used by aliases. Thought about implementing a generic hashtable, but I would go with the specific one for performance reasons.
+ * @brief Implementation of a hashtable to be used by aliases (and the shell's variables). Thought about implementing a generic hashtable, but I would go with the specific one for performance reasons.
+ * 
+ * The table is a flat array of entries with open addressing (linear probing), so a lookup touches one or two cache lines instead of following a chain of nodes. Every entry caches the hash of its key, and short keys are stored in the entry itself. The table doubles when it gets 3/4 full, and deleted entries are removed by shifting the entries after them back, so there are no tombstones.
  * @version 0.1
  * @date 2023-06-27
  * @copyright Copyright (c) 2023
@@ -12,50 +14,48 @@
 #define HASHTABLE_H
 
 #include "utils.h"
+#include "output.h"
+#include "lexer.h"
+
+// number of entries a new table starts with, it grows as needed
+#define HASHTABLE_INITIAL_CAPACITY 16
 
-#define NUMBER_OF_BUCKETS 101
+// keys shorter than this are stored in the entry, longer ones are allocated
+#define HT_INLINE_KEY 24
 
 /**
- * @brief The struct represents a key-value pair in the hashtable.
- * 
- * Since the hashtable is implemented using chaining, the struct also contains a pointer to the next entry in the chain. Both key and value are strings.
+ * @brief The struct represents a key-value pair in the hashtable, i.e. a slot of the table. Both key and value are strings.
  * 
  */
 typedef struct htEntry
 {
-    char *key;              //< The key of the entry
-    char *value;            //< The value of the entry
-    struct htEntry *next;   //< Pointer to the next entry in the chain
+    unsigned hash;                  //< The hash of the key
+    unsigned keyLength;             //< The length of the key
+    char *value;                    //< The value of the entry, NULL if the slot is empty
+    char *longKey;                  //< The key, if it doesn't fit in inlineKey. NULL otherwise
+    TokenList *tokens;              //< The value split into tokens, made the first time it is needed and dropped when the value changes. NULL until then
+    char inlineKey[HT_INLINE_KEY];  //< The key, if it is shorter than HT_INLINE_KEY
 } htEntry;
 
 /**
- * @brief The struct represents the hashtable itself. It contains an array of linked lists, which are used to implement chaining.
+ * @brief The struct represents the hashtable itself.
  * 
  */
 typedef struct hashtable
 {
-    int size;                       //< The size of the hashtable
-    struct linkedList **buckets;    //< The array of linked lists
+    htEntry *entries;   //< The slots, a power of two of them
+    size_t capacity;    //< The number of slots
+    size_t count;       //< The number of entries in use
 } hashtable;
 
-/**
- * @brief The struct represents a linked list. It contains pointers to the head and tail of the list.
- * 
- */
-typedef struct linkedList
-{
-    struct htEntry *head;  //< Pointer to the head of the list
-    struct htEntry *tail;  //< Pointer to the tail of the list
-} linkedList;
-
 
 /**
  * @brief Creates a Hashtable object.
  * 
- * The function allocates memory for the hashtable and initializes the buckets. All the buckets are initialized to NULL.
+ * The function allocates memory for the hashtable and its slots, all of them empty.
  * 
- * @param size The size of the hashtable
- * @return hashtable* Pointer to the hashtable
+ * @param size The number of entries the table is expected to hold. It grows past it when needed.
+ * @return hashtable* Pointer to the hashtable, NULL on failure
  */
 hashtable *createHashtable(int size);
 
@@ -69,18 +69,19 @@ hashtable *createHashtable(int size);
 void deleteHashtable(hashtable* ht);
 
 /**
- * @brief Standard set function for the hashtable. It takes a key and a value and sets the value for the given key.
+ * @brief Standard set function for the hashtable. It takes a key and a value and sets the value for the given key. A NULL value removes the key.
  * 
  * @param ht The hashtable to be used
  * @param key Key to be used
  * @param value Value to be set
+ * @return int 0 on success, -1 on failure
  */
-void set(hashtable* ht, const char* key, const char* value);
+int set(hashtable* ht, const char* key, const char* value);
 
 /**
  * @brief Standard get function for the hashtable. It takes a key and returns the value for the given key. If the key is not found, it returns NULL.
  * 
- * The function first calculates the hash of the key and then traverses the linked list at the index of the hash to find the key. If the key is found, it returns the value, otherwise it returns NULL. Returns a pointer to the stored value instead of copying it.
+ * The function probes the slots from the one the hash of the key maps to, comparing the cached hashes first, until it finds the key or an empty slot. Returns a pointer to the stored value instead of copying it.
  * 
  * @param ht Hashtable to be used.
  * @param key Key to be used.
@@ -89,10 +90,48 @@ void set(hashtable* ht, const char* key, const char* value);
 char* get(hashtable* ht, const char* key);
 
 /**
- * @brief Prints the hashtable in the following format: `"%s=%s\n", key, value`
+ * @brief Like get, for a key given by its length, which doesn't have to be NUL terminated (e.g. a name in the middle of a word).
+ * 
+ * @param ht Hashtable to be used.
+ * @param key Key to be used.
+ * @param length Length of the key.
+ * @return char* Value for the given key, NULL if it is not in the table.
+ */
+char* getn(hashtable* ht, const char* key, size_t length);
+
+/**
+ * @brief Returns the value of a key split into tokens. The value is tokenized on the first call, later calls return the same tokens until the value is set again or removed.
+ * 
+ * @param ht Hashtable to be used.
+ * @param key Key to be used.
+ * @return const TokenList* The tokens of the value, NULL if the key is not in the table (or there was no memory for them). If the value couldn't be tokenized, the list's error says why.
+ */
+const TokenList* getTokens(hashtable* ht, const char* key);
+
+/**
+ * @brief Removes a key from the hashtable, freeing its entry.
+ * 
+ * @param ht Hashtable to be used.
+ * @param key Key to be removed.
+ * @return int 0 if the key was removed, -1 if it wasn't in the table
+ */
+int removeKey(hashtable* ht, const char* key);
+
+/**
+ * @brief Calls a function for every entry of the hashtable, in no particular order. The table must not be changed while it is being walked.
+ * 
+ * @param ht Hashtable to be walked
+ * @param visit The function, called with the key and value of every entry
+ * @param context Passed to the function as it is
+ */
+void forEachEntry(hashtable* ht, void (*visit)(const char* key, const char* value, void* context), void* context);
+
+/**
+ * @brief Prints the hashtable in the following format: `"%s='%s'\n", key, value`
  * 
  * @param ht Hashtable to be printed
+ * @param sink The sink the entries are written to
  */
-void printHashtable(hashtable* ht);
+void printHashtable(hashtable* ht, OutputSink* sink);
 
-#endif // HASHTABLE_H
\ No newline at end of file
+#endif // HASHTABLE_H
@@ -0,0 +1,46 @@
+/**
+ * @file input.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief The reader of the shell's standard input when it isn't a terminal. The commands come from the same input that the commands themselves read from, so the shell must not consume more of it than the line it is about to run: `head -n 1` on the next line of the input has to see that line.
+ *
+ * Seekable input (a file) is read a block at a time into a buffer that is reused for every line, and the offset is moved back to the end of the last line returned before a child process is started. Input that can't be seeked back (a pipe) is read a byte at a time, so that nothing past the current line is ever taken from it.
+ * @version 0.1
+ * @date 2023-07-30
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "utils.h"
+
+/**
+ * @brief Starts reading input from a file descriptor.
+ *
+ * @param fd The file descriptor, normally stdin
+ */
+void initInput(int fd);
+
+/**
+ * @brief Reads the next line of input, removing the trailing newline.
+ *
+ * @param line The buffer to read into. Initialize it to {NULL, 0} before the first read.
+ * @return ssize_t The length of the line, or -1 on EOF or error
+ */
+ssize_t readInputLine(LineBuffer* line);
+
+/**
+ * @brief Gives back the input read ahead of the current line, by seeking the file descriptor back to where the current line ends. Called before starting a child process that inherits the shell's stdin, which shares the file offset with the shell. The read ahead input is thrown away, so it isn't called for children whose stdin is redirected.
+ *
+ */
+void syncInput(void);
+
+/**
+ * @brief Frees the buffer of the input.
+ *
+ */
+void freeInput(void);
+
+#endif // INPUT_H
@@ -0,0 +1,221 @@
+/**
+ * @file jobs.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief The job table. Every pipeline that starts child processes becomes a job, with its own process group, so that it can be waited on, stopped, continued and moved between the foreground and the background.
+ * @version 0.1
+ * @date 2023-07-10
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "command.h"
+
+#include <signal.h>
+#include <stdbool.h>
+
+/**
+ * @brief State of a single process, or of a job as a whole.
+ *
+ */
+typedef enum JobState
+{
+    JOB_RUNNING,    //< at least one process is still running
+    JOB_STOPPED,    //< nothing is running, and at least one process is stopped
+    JOB_DONE        //< every process has terminated
+} JobState;
+
+/**
+ * @brief A process that belongs to a job.
+ *
+ */
+typedef struct Process
+{
+    int pid;            //< pid of the process
+    int status;         //< exit status of the process once it is done (128 + signal number if it was killed)
+    JobState state;     //< state of the process
+} Process;
+
+/**
+ * @brief This struct represents a job, i.e. a pipeline whose processes share a process group.
+ *
+ * Jobs are kept in a linked list (the job table), ordered by when they were created. Foreground jobs are in the table as well while they run, so that a stopped foreground job can be picked up later with fg/bg.
+ *
+ */
+typedef struct Job
+{
+    int id;                 //< job number, as shown by `jobs` ([1], [2], ...)
+    int pgid;               //< process group of the job, 0 until the first process is started. the shell's own group without job control
+
+    Process* processes;     //< array of processes in the job
+    int nProcesses;         //< number of processes in the array
+    int capacity;           //< capacity of the processes array
+
+    bool foreground;        //< whether the job owns the terminal (and the shell waits on it)
+    bool notified;          //< whether the user has been told that the job stopped/finished
+    char* commandLine;      //< the pipeline's text, for `jobs`, `fg` and `bg`
+
+    struct Job* next;       //< next job in the table
+} Job;
+
+// pid of the most recent background job, 0 if there's none
+extern int lastBackgroundPid;
+
+// ------------------------- Setup --------------------------------
+
+/**
+ * @brief Sets up job control for the shell. Installs the SIGCHLD handler, and if the shell has a terminal, puts the shell in its own process group in the foreground of that terminal and ignores the job control signals.
+ *
+ * @param interactive Whether the shell is running interactively.
+ */
+void initJobControl(bool interactive);
+
+/**
+ * @brief Frees the job table. Running jobs are left running.
+ *
+ */
+void cleanUpJobs(void);
+
+// ------------------------- Launching --------------------------------
+
+/**
+ * @brief Creates a job for a command and adds it to the job table. The job doesn't have any processes until they're added via addProcessToJob.
+ *
+ * @param command The command (pipeline) the job runs
+ * @return Job* The job, or NULL on failure
+ */
+Job* createJob(Command* command);
+
+/**
+ * @brief Called in the parent after a process of the job has been started. Records the process, puts it in the job's process group (the first process becomes the group leader), and hands the terminal to the group if the job is in the foreground.
+ *
+ * @param job The job the process belongs to
+ * @param pid The pid of the process
+ * @return int Status code (0 on success, -1 on failure)
+ */
+int addProcessToJob(Job* job, int pid);
+
+/**
+ * @brief Called in a freshly forked child, before it runs anything. Moves the child into the job's process group, gives it the terminal if the job is in the foreground, and restores the signal dispositions the shell changed.
+ *
+ * @param job The job the child belongs to, may be NULL in which case only the signals are reset
+ */
+void setUpJobProcess(Job* job);
+
+/**
+ * @brief Checks if the processes of the job go in a process group of their own. They do with job control, i.e. in an interactive shell, otherwise they stay in the shell's process group, unless the job's pgid was reset to 0 to start a new group.
+ *
+ * @param job The job
+ * @return true if the job's processes have to join job->pgid
+ */
+bool isJobInOwnGroup(Job* job);
+
+/**
+ * @brief Returns the terminal a process of the job has to take when it starts, or -1 if it shouldn't take any (background job, or the shell has no terminal).
+ *
+ * @param job The job
+ * @return int The terminal's file descriptor, or -1
+ */
+int getJobTerminal(Job* job);
+
+/**
+ * @brief Fills a set with the signals the shell ignores or catches for itself, which a child has to reset to their default action.
+ *
+ * @param signals The set to fill
+ */
+void getJobSignals(sigset_t* signals);
+
+/**
+ * @brief Reports a job that was just started in the background, as `[id] pgid`. Only done in interactive mode.
+ *
+ * @param job The background job
+ */
+void reportBackgroundJob(Job* job);
+
+/**
+ * @brief Removes a job from the job table and frees it.
+ *
+ * @param job The job to remove
+ */
+void removeJob(Job* job);
+
+// ------------------------- Waiting --------------------------------
+
+/**
+ * @brief Waits until no process of the job is running, i.e. all of them are done or the job got stopped. Foreground jobs get the terminal back to the shell afterwards.
+ *
+ * @param job The job to wait on
+ * @return int The status of the last process of the job, 128 + the signal that stopped it if the job was stopped (e.g. 147 for SIGSTOP), or 128 + the signal if a signal for the shell interrupted the wait
+ */
+int waitForJob(Job* job);
+
+/**
+ * @brief The event loop every wait on jobs goes through. Waits until no process of the jobs is running, all of them at once.
+ *
+ * The shell's SIGCHLD and the signals sent to the shell itself (SIGINT, SIGQUIT, SIGTERM, SIGHUP) are read from a signalfd, and every running process gets a pidfd, all in one epoll instance, so that a wakeup only looks at what is ready. Exits are collected through the pidfds, stops when SIGCHLD comes in. A signal for the shell is forwarded to the foreground jobs being waited on, which don't get it otherwise, being in process groups of their own. A non-interactive shell is then ended by the same signal once the wait is over.
+ *
+ * @param jobs The jobs to wait on
+ * @param nJobs Number of jobs
+ * @param timeout Most milliseconds to wait, -1 to wait as long as it takes
+ * @return int 0 once none of the processes is running, 1 if the timeout expired first, 128 + the signal if a signal for the shell that no job could take interrupted the wait
+ */
+int awaitJobs(Job** jobs, int nJobs, int timeout);
+
+/**
+ * @brief Collects the status of any job processes that changed state, without blocking. Cheap to call when nothing happened, as the SIGCHLD handler only sets a flag that this function checks.
+ *
+ */
+void reapJobs(void);
+
+/**
+ * @brief Reaps the jobs, then reports jobs that finished or stopped since the last notification (in interactive mode), and drops finished jobs from the table.
+ *
+ */
+void notifyJobs(void);
+
+// ------------------------- Lookup --------------------------------
+
+/**
+ * @brief Finds a job from a job spec: `%n`, `%%`, `%+`, `%-`, or a pid of one of its processes. NULL spec means the current job.
+ *
+ * @param spec The job spec
+ * @return Job* The job, or NULL if there's no such job
+ */
+Job* findJob(const char* spec);
+
+/**
+ * @brief Returns the first job of the job table, for iterating over it.
+ *
+ * @return Job* Head of the job table
+ */
+Job* getJobs(void);
+
+/**
+ * @brief Returns the state of a job, derived from the states of its processes.
+ *
+ * @param job The job
+ * @return JobState The job's state
+ */
+JobState getJobState(Job* job);
+
+/**
+ * @brief Returns the character marking a job in `jobs` output: '+' for the current job, '-' for the previous one, ' ' otherwise.
+ *
+ * @param job The job
+ * @return char The marker
+ */
+char getJobMarker(Job* job);
+
+/**
+ * @brief Continues a stopped job, sending SIGCONT to its process group.
+ *
+ * @param job The job to continue
+ * @param foreground Whether the job should be continued in the foreground (it gets the terminal)
+ * @return int Status code (0 on success, -1 on failure)
+ */
+int continueJob(Job* job, bool foreground);
+
+#endif // JOBS_H
@@ -0,0 +1,94 @@
+/**
+ * @file lexer.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief The lexer splits a line of input into words and operators in a single pass. All the token bytes of a line are written into one contiguous arena, and tokens are views (offset/length) into it, so lexing a line costs a constant number of allocations.
+ * @version 0.1
+ * @date 2023-07-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef LEXER_H
+#define LEXER_H
+
+#include "utils.h"
+
+#include <stdbool.h>
+
+/**
+ * @brief The types of tokens. Operators don't need surrounding spaces, e.g. `ls|wc -l>out` is five words and two operators.
+ *
+ */
+typedef enum TokenType
+{
+    TOKEN_WORD,             //< a word, with its quotes removed
+    TOKEN_PIPE,             //< |
+    TOKEN_AND,              //< &&
+    TOKEN_OR,               //< ||
+    TOKEN_SEMICOLON,        //< ; or a newline
+    TOKEN_BACKGROUND,       //< &
+    TOKEN_REDIR_IN,         //< <
+    TOKEN_REDIR_OUT,        //< >
+    TOKEN_REDIR_APPEND      //< >>
+} TokenType;
+
+// flags of a word token
+#define TOKEN_QUOTED 0x1    /* some part of the word was quoted or escaped, so it is not subject to alias expansion */
+#define TOKEN_EXPAND 0x2    /* the word has parameters to expand, marked by the EXPAND_* characters in its text */
+#define TOKEN_ASSIGNMENT 0x4 /* the word is an assignment, i.e. starts with an unquoted name and '=' */
+
+// the lexer replaces a '$' that starts a parameter expansion with one of these, so that it can't be confused with a quoted or escaped '$' once the quotes are removed
+#define EXPAND_UNQUOTED '\x01'  /* the expansion is subject to field splitting */
+#define EXPAND_QUOTED '\x02'    /* the expansion was inside double quotes, and makes a single field */
+
+// quoted characters that would be special to pathname expansion are written to a word's text with a backslash before them, so that only its unquoted wildcards are wildcards. every backslash in the text of a word escapes the character after it, the escapes are removed when the word is expanded
+#define QUOTED_ESCAPES "*?[\\~"
+
+/**
+ * @brief A token, as a view into the arena of its token list.
+ *
+ */
+typedef struct Token
+{
+    TokenType type;     //< type of the token
+    unsigned flags;     //< TOKEN_* flags, for words
+    size_t offset;      //< offset of the token's text in the arena. the text is NUL terminated
+    size_t length;      //< length of the token's text
+} Token;
+
+/**
+ * @brief The tokens of a line of input.
+ *
+ * The tokens array and the arena live in a single allocation, which is reused by the next tokenize call on the same list when it is big enough.
+ *
+ */
+typedef struct TokenList
+{
+    Token* tokens;      //< the tokens
+    int count;          //< number of tokens
+    char* arena;        //< the text of all the tokens, one after another, each NUL terminated
+    size_t capacity;    //< size of the allocation behind tokens and arena
+    const char* error;  //< why the last tokenize call failed, NULL if it didn't
+} TokenList;
+
+// the text of the i-th token of a token list
+#define TOKEN_TEXT(list, i) ((list)->arena + (list)->tokens[i].offset)
+
+/**
+ * @brief Splits a line into tokens. Quotes (single and double) and backslashes are removed from words, and the quoted characters in QUOTED_ESCAPES are escaped with a backslash instead, `#` at the start of a word starts a comment. A `$` that isn't quoted or escaped is replaced by an EXPAND_* character, the expansion itself happens when the command runs. Blanks and operators inside a `${...}` are part of the word.
+ *
+ * @param input The line to tokenize
+ * @param list The list to fill. Initialize it to {NULL, 0, NULL, 0, NULL} before the first call, it can be reused for the next line afterwards.
+ * @return int Status code (0 on success, -1 on an unterminated quote or allocation failure, with the reason in list->error for the caller to report)
+ */
+int tokenize(const char* input, TokenList* list);
+
+/**
+ * @brief Frees the memory of a token list.
+ *
+ * @param list The list to free
+ */
+void freeTokenList(TokenList* list);
+
+#endif // LEXER_H
@@ -23,7 +23,7 @@
 #define LOG_WHITE   "\033[1;37m"
 
 // defines for logging modes
-#define LOG_ERR     0  /* For printing critical errors, always get printed */
+#define LOG_ERR     0  /* For printing critical errors, always get printed (to stderr, like other shells do) */
 #define LOG_DBG     1  /* For printing debug print statements, only in debug mode */
 #define LOG_PRI     2  /* For normal printing of messages, always get printed without annotations */
 
@@ -79,7 +79,8 @@
                 break; \
             } \
         }\
-        if (type == LOG_ERR || type == LOG_PRI) { LOG_OUT(__VA_ARGS__); } \
+        if (type == LOG_ERR) { LOG_STDERR(__VA_ARGS__); } \
+        else if (type == LOG_PRI) { LOG_OUT(__VA_ARGS__); } \
     } while (0)
 
 #endif // LOG_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+/**
+ * @file output.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief An output sink, which is how builtins write their output. Output is collected in a buffer and written straight to the builtin's output descriptor with write/writev, so a builtin running in the shell process doesn't have to move its descriptors onto stdout (and back) to print, nor go through stdio.
+ * @version 0.1
+ * @date 2023-07-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "utils.h"
+
+#include <stdarg.h>
+
+// size of a sink's buffer. output that doesn't fit is written out together with the buffer, without being copied
+#define OUTPUT_BUFFER_SIZE 4096
+
+/**
+ * @brief An output sink, writing to a file descriptor.
+ *
+ */
+typedef struct OutputSink
+{
+    int fd;                             //< the descriptor the output goes to
+    int error;                          //< errno of the first failed write, 0 if none. output is dropped after a failure
+    size_t length;                      //< number of bytes in the buffer
+    char buffer[OUTPUT_BUFFER_SIZE];    //< output not written yet
+} OutputSink;
+
+/**
+ * @brief Initializes a sink writing to a descriptor.
+ *
+ * @param sink The sink to initialize
+ * @param fd The descriptor to write to
+ */
+void initOutputSink(OutputSink* sink, int fd);
+
+/**
+ * @brief Writes bytes to the sink.
+ *
+ * @param sink The sink
+ * @param data The bytes
+ * @param length Number of bytes
+ * @return int Status code (0 on success, -1 if a write failed)
+ */
+int sinkWrite(OutputSink* sink, const char* data, size_t length);
+
+/**
+ * @brief Writes a string to the sink.
+ *
+ * @param sink The sink
+ * @param str The string
+ * @return int Status code (0 on success, -1 if a write failed)
+ */
+int sinkPuts(OutputSink* sink, const char* str);
+
+/**
+ * @brief Writes formatted output to the sink, like printf.
+ *
+ * @param sink The sink
+ * @param format The format string
+ * @return int Status code (0 on success, -1 if a write failed)
+ */
+int sinkPrintf(OutputSink* sink, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Writes out whatever is in the sink's buffer. Has to be called before the sink goes out of scope.
+ *
+ * @param sink The sink
+ * @return int Status code (0 on success, -1 if this or any earlier write failed)
+ */
+int sinkFlush(OutputSink* sink);
+
+#endif // OUTPUT_H
@@ -2,30 +2,36 @@
 #define PARSER_H
 
 #include "command.h"
+#include "lexer.h"
 
-// Useful macros for readability
+// Useful macros for readability. they all take a pointer to a Token
 
-// macro to test if a token is a chaining operator. the chaining operators are &&, ||, and ;. macro resolves to 1 if the token is a chaining operator, 0 otherwise
-#define IS_CHAINING_OPERATOR(token) (strcmp(token, "&&") == 0 || strcmp(token, "||") == 0 || strcmp(token, ";") == 0)
+// get a pointer to the token at the index, or NULL past the last token
+#define TOKEN_AT(list, index) ((index) < (list)->count ? &(list)->tokens[index] : NULL)
+// macro to test if a token is a chaining operator. the chaining operators are &&, ||, ; and & (which also sends the command to the background). macro resolves to 1 if the token is a chaining operator, 0 otherwise
+#define IS_CHAINING_OPERATOR(token) ((token)->type == TOKEN_AND || (token)->type == TOKEN_OR || (token)->type == TOKEN_SEMICOLON || IS_BACKGROUND(token))
+// check if the token is the background operator
+#define IS_BACKGROUND(token) ((token)->type == TOKEN_BACKGROUND)
 // check if the token is a pipe
-#define IS_PIPE(token) (strcmp(token, "|") == 0)
+#define IS_PIPE(token) ((token)->type == TOKEN_PIPE)
 // check if the token is file output redirection operator
-#define IS_FILE_OUT_REDIR(token) (strcmp(token, ">") == 0 || strcmp(token, ">>") == 0)
+#define IS_FILE_OUT_REDIR(token) ((token)->type == TOKEN_REDIR_OUT || (token)->type == TOKEN_REDIR_APPEND)
 // check if the token is file input redirection operator
-#define IS_FILE_IN_REDIR(token) (strcmp(token, "<") == 0) 
+#define IS_FILE_IN_REDIR(token) ((token)->type == TOKEN_REDIR_IN)
 // check if the token is NULL
 #define IS_NULL(token) (!token)
-// check if the token is ignorable
-#define IGNORE(token) (strcmp(token, " ") == 0 || strcmp(token, "\t") == 0 || strcmp(token, "\n") == 0 || strcmp(token, "") == 0)
+// check if the token is a word
+#define IS_WORD(token) ((token) && (token)->type == TOKEN_WORD)
 // check if the token is the append operator
-#define IS_APPEND(token) (strcmp(token, ">>") == 0)
+#define IS_APPEND(token) ((token)->type == TOKEN_REDIR_APPEND)
 
 /**
- * @brief Parses the tokens and returns a command chain. It is the responsibility of the caller to free the memory.
+ * @brief Parses the tokens and returns a command chain. The chain is allocated from the arena, and is freed by resetting it.
  * 
- * @param tokens The tokens to parse. Assumes that the tokens array is null terminated.
+ * @param tokens The tokens to parse, as produced by the lexer.
+ * @param arena The arena of the line being parsed.
  * @return CommandChain* The command chain that was parsed.
  */
-CommandChain* parseTokens(char** tokens);
+CommandChain* parseTokens(TokenList* tokens, Arena* arena);
 
 #endif // PARSER_H
\ No newline at end of file
@@ -0,0 +1,58 @@
+/**
+ * @file script_cache.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief The compiled script cache, used when SHELL_SCRIPT_CACHE is set in the shell's environment. The first time a script is run, its lines are lexed and parsed as the shell runs them, and the resulting command chains are serialized to a hidden `.<script>.shc` file next to the script. Later runs of the unchanged script read the command chains back from that file instead of lexing and parsing every line again.
+ *
+ * The cache is keyed on the script's device, inode, size and modification time, and is rebuilt when any of them changes. It is only used if it is owned by the user running the shell and can't be written by anyone else, and scripts changed in the last second aren't compiled, since a change within the same timestamp tick would go unnoticed. Since aliases and wildcards are expanded when a command is executed, the parsed form of a line doesn't depend on anything but the line itself.
+ * @version 0.1
+ * @date 2023-07-24
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef SCRIPT_CACHE_H
+#define SCRIPT_CACHE_H
+
+#include "command.h"
+
+// bumped whenever the layout of the cache file (or the text of the words in it) changes, so that caches written by an older shell are rebuilt
+#define SCRIPT_CACHE_VERSION 6
+
+/**
+ * @brief Opens the compiled form of a script. If there's no up to date one, the script is compiled while it runs instead: the lines read from it have to be passed to compileScriptLine.
+ *
+ * @param scriptPath Path of the script
+ * @param script The script, opened for reading and not read from yet
+ * @return FILE* The cache, positioned at its first line, or NULL if there's no cache to use, in which case the script should be read directly
+ */
+FILE* openScriptCache(const char* scriptPath, FILE* script);
+
+/**
+ * @brief Compiles a line just read from the script, and writes it to the script's cache. Does nothing if the script isn't being compiled.
+ *
+ * @param line The line
+ * @param arena The arena the line's command chain is allocated from
+ * @return CommandChain* The line's command chain, or NULL if the script isn't being compiled or the line doesn't lex or parse (the caller lexes and parses it itself then)
+ */
+CommandChain* compileScriptLine(const char* line, Arena* arena);
+
+/**
+ * @brief Finishes the cache of the script being compiled, compiling what's left of the script, and puts it in place. Meant to be called when the shell is done with the script, or is about to exit or exec. The script is left where it was.
+ *
+ */
+void finishScriptCache(void);
+
+/**
+ * @brief Reads the next line of a compiled script.
+ *
+ * @param cache The cache, as returned by openScriptCache
+ * @param arena The arena the line and its command chain are allocated from
+ * @param line Set to the text of the line
+ * @param chain Set to the line's command chain, or NULL if the line couldn't be parsed when it was compiled (it then has to be lexed and parsed again, to report the error)
+ * @param offset Offset in the script of the line after the last one read, 0 before the first line. Set to the offset of the line after this one. On failure it is where the rest of the script has to be read from the script itself.
+ * @return int Status code (0 on success, -1 at the end of the cache or if the line couldn't be read)
+ */
+int readCompiledLine(FILE* cache, Arena* arena, char** line, CommandChain** chain, long* offset);
+
+#endif // SCRIPT_CACHE_H
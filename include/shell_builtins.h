@@ -17,6 +17,20 @@
 #define HOME_DIR getenv("HOME")
 #define MAX_PATH_LENGTH 1024
 
+/* The shell supports three different modes:
+ * 1. Interactive: The default usage. An interactive command line.
+ * 2. Non_interactive: When the input is not via a terminal but by any other mean.
+ * 3. Script: Runs a list of commands specified in a file.
+ * 4. Command: Runs the commands given as a string with -c.
+ */
+#define INTERACTIVE_MODE 1
+#define NON_INTERACTIVE_MODE 2
+#define SCRIPT_MODE 3
+#define COMMAND_MODE 4
+
+// the mode the shell is running in, set once at startup
+extern int mode;
+
 typedef int (*ExecutionFunction)(SimpleCommand*);
 
 /**
@@ -43,6 +57,13 @@ int cd(SimpleCommand* command);
  */
 int exitShell(SimpleCommand* command);
 
+/**
+ * @brief Leaves the shell, after finishing the cache of the script being run. Used by exit, and by errors that end a non-interactive shell.
+ *
+ * @param status The exit status of the shell
+ */
+void terminateShell(int status);
+
 /**
  * @brief This function is the builtin for the pwd command.
  * 
@@ -75,6 +96,38 @@ int alias(SimpleCommand* command);
  */
 int unalias(SimpleCommand* command);
 
+/**
+ * @brief This function is the builtin for the export command. Without arguments it lists the exported variables.
+ * 
+ * @param command The command to be executed.
+ * @return int Returns 0 on success, 1 if a variable couldn't be exported, -1 on failure.
+ */
+int exportVariables(SimpleCommand* command);
+
+/**
+ * @brief This function is the builtin for the unset command.
+ * 
+ * @param command The command to be executed.
+ * @return int Returns 0 on success, 1 if a variable couldn't be unset.
+ */
+int unsetVariables(SimpleCommand* command);
+
+/**
+ * @brief This function is the builtin for the exec command. Replaces the shell with the given command, or without a command, applies the redirections to the shell itself.
+ * 
+ * @param command The command to be executed.
+ * @return int Doesn't return if the shell was replaced. Returns 0 on success, 127 if the command wasn't found, 126 if it couldn't be executed, 1 if a redirection couldn't be applied.
+ */
+int execCommand(SimpleCommand* command);
+
+/**
+ * @brief This function is the builtin for the timeout command, `timeout [-k duration] [-s signal] [--preserve-status] duration command [args...]`. Runs the command as a process of the builtin's job, and sends it the signal (TERM by default) if it's still running once the duration is over, then KILL after the -k duration. Durations are like GNU timeout's (e.g. 1.5, 30s, 2m), 0 means no timeout.
+ * 
+ * @param command The command to be executed.
+ * @return int Returns the status of the command, 124 if it timed out (unless --preserve-status is given, or it had to be killed, which makes it 137), 125 if the builtin itself failed, 126 or 127 if the command couldn't be run.
+ */
+int timeoutCommand(SimpleCommand* command);
+
 /**
  * @brief This function is the builtin for the history command.
  * 
@@ -84,13 +137,69 @@ int unalias(SimpleCommand* command);
 int history(SimpleCommand* command);
 
 /**
- * @brief This function executes a process.
+ * @brief This function is the builtin for the jobs command. Lists the jobs in the job table.
+ * 
+ * @param command The command to be executed.
+ * @return int Returns 0 on success, -1 on failure.
+ */
+int jobs(SimpleCommand* command);
+
+/**
+ * @brief This function is the builtin for the fg command. Continues a job in the foreground, and waits for it.
+ * 
+ * @param command The command to be executed.
+ * @return int Returns the status of the job, -1 on failure.
+ */
+int fg(SimpleCommand* command);
+
+/**
+ * @brief This function is the builtin for the bg command. Continues a stopped job in the background.
+ * 
+ * @param command The command to be executed.
+ * @return int Returns 0 on success, -1 on failure.
+ */
+int bg(SimpleCommand* command);
+
+/**
+ * @brief This function is the builtin for the wait command. Waits for all background jobs, or for the given ones.
  * 
- * The process is executed by forking a child process, and then executing the command in the child process.
+ * @param command The command to be executed.
+ * @return int Returns 0 when waiting for all jobs, otherwise the status of the last job waited for (127 if it doesn't exist).
+ */
+int waitForJobs(SimpleCommand* command);
+
+/**
+ * @brief This function is the builtin for the hash command. Lists (`hash`), clears (`hash -r`) or fills (`hash name...`) the command location cache.
  * 
  * @param command The command to be executed.
- * @return int Returns non-zero status on failue. else returns 0 on success
+ * @return int Returns 0 on success, 1 if a command wasn't found, -1 on failure.
+ */
+int hashCommands(SimpleCommand* command);
+
+/**
+ * @brief Forgets all the command locations remembered by the command location cache. The cache is also cleared on its own when PATH changes.
+ * 
+ */
+void clearCommandCache(void);
+
+/**
+ * @brief This function starts a process.
+ * 
+ * The command is looked up in PATH through the command location cache, then the process is started with posix_spawn (a vfork-style clone followed by exec), with the simple command's FDs and the job's process group applied by the spawn itself. The function doesn't wait for the child, it stores the child's pid in the simple command so that the caller can start the rest of the pipeline first and reap all the stages together through the job the simple command belongs to.
+ * 
+ * @param command The command to be executed.
+ * @return int Returns non-zero status if the process couldn't be started. else returns 0 on success
  */
 int executeProcess(SimpleCommand* command);
 
+/**
+ * @brief Replaces the shell with a process, by exec'ing it directly without a fork. The process gets the simple command's FDs as its stdin and stdout, its environment, and the signal dispositions a child of the shell would get.
+ * 
+ * @param command The simple command the process is run for
+ * @param args The args of the process, starting with its name
+ * @return int Only returns if the process couldn't be executed, with 127 if it wasn't found and 126 otherwise. The shell is left as it was.
+ */
+int replaceShell(SimpleCommand* command, char** args);
+
+
 #endif // BUILTINS_H
\ No newline at end of file
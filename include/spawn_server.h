@@ -0,0 +1,71 @@
+/**
+ * @file spawn_server.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief The spawn server, an optional helper process that starts the shell's processes for it. It is forked when the shell starts, before the shell has built any of its state, and is sent each process to start (path, args, environment, and the FDs over SCM_RIGHTS) over a socketpair. It starts them from its own small address space with a clone that makes them children of the shell, not of the server, so the shell waits on them and controls them as jobs like any other child.
+ *
+ * The server is enabled by setting SHELL_SPAWN_SERVER in the shell's environment. Processes are started with posix_spawn from the shell itself when it isn't running, or when a request doesn't fit in a message.
+ * @version 0.1
+ * @date 2023-07-31
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef SPAWN_SERVER_H
+#define SPAWN_SERVER_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ * @brief A process for the server to start.
+ *
+ */
+typedef struct SpawnRequest
+{
+    const char* path;       //< path of the executable
+    char** args;            //< args of the process, NULL terminated
+    char** environment;     //< environment of the process, NULL terminated
+    int inputFD;            //< becomes the stdin of the process
+    int outputFD;           //< becomes the stdout of the process
+    bool setProcessGroup;   //< whether the process joins processGroup
+    pid_t processGroup;     //< the process group to join, 0 for a new group led by the process
+    int terminalFD;         //< the terminal the process' group is given, -1 to leave the terminal alone
+} SpawnRequest;
+
+/**
+ * @brief Forks the spawn server. Meant to be called first thing in main, while the shell is still small.
+ *
+ * @return int Status code (0 on success, -1 on failure)
+ */
+int startSpawnServer(void);
+
+/**
+ * @brief Checks if the spawn server is running.
+ *
+ * @return true if requests can be sent to it
+ */
+bool spawnServerRunning(void);
+
+/**
+ * @brief Has the spawn server start a process. The process is a child of the shell, and the server returns once it has exec'd (or failed to).
+ *
+ * @param request The process to start
+ * @param pid Set to the pid of the process. If the exec failed, it is the pid of a child that has already exited, which the caller has to reap (-1 if no child was started)
+ * @return int 0 on success, the errno of the exec if it failed, -1 if the server couldn't take the request and the process has to be started some other way
+ */
+int requestSpawn(const SpawnRequest* request, pid_t* pid);
+
+/**
+ * @brief Stops the spawn server, and waits for it to exit.
+ *
+ */
+void stopSpawnServer(void);
+
+/**
+ * @brief Drops the spawn server in a forked child of the shell, which starts its processes itself from then on. The server would make the processes children of the shell instead of the child, and the replies to the shell's and the child's requests could cross. Only the child's copy of the socket is closed, the server keeps running for the shell.
+ *
+ */
+void detachSpawnServer(void);
+
+#endif // SPAWN_SERVER_H
@@ -14,19 +14,18 @@
 
 #include "log.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/types.h>
 
 // Exposed macros for logging
 #define LOG_ERROR(...) LOG(LOG_ERR, "[ERROR]", LOG_COLOR_ERR, LOG_STDERR, __VA_ARGS__)
 #define LOG_DEBUG(...) LOG(LOG_DBG, "[DEBUG]", LOG_COLOR_DBG, LOG_STDERR, __VA_ARGS__)
 #define LOG_PRINT(...) LOG(LOG_PRI, "[PRINT]", LOG_COLOR_PRI, LOG_OUT, __VA_ARGS__)
 
-// we specify that the strings in our program won't exceed length of 100 characters
-#define MAX_STRING_LENGTH 1024
-
-// in order to be consistent, let's just define a macro for copying strings
-#define COPY(str) (str ? strndup(str, MAX_STRING_LENGTH) : NULL)
+// in order to be consistent, let's just define a macro for copying strings. strings aren't capped in length, so a copy is always the whole string
+#define COPY(str) (str ? strdup(str) : NULL)
 
 // useful macros for string handling
 #define CAT(X,Y) X##Y
@@ -39,38 +38,29 @@
 #define PIPE_WRITE_END 1
 
 /**
- * @brief This function tokenizes a string, given a delimiter.
- * 
- * It returns an array of tokens, and the number of tokens in the array. The function ignores any delimiter encountered inside quotes.
- * It is the responsibility of the caller to free the memory via the freeTokens() function.
- * 
- * @param str String to tokenize
- * @param delimiter Delimiter to use for tokenization
- * @return char** Array of tokens (NULL terminated)
- */
-char** tokenizeString(const char* str, const char delimiter);
-
-/**
- * @brief This function frees the memory allocated by tokenizeString()
+ * @brief A growable buffer holding a line of input. The buffer is reused across reads, and only grows when a line longer than any before it is read, so reading doesn't allocate per line and there is no limit on the length of a line.
  * 
- * @param tokens Array of tokens
  */
-void freeTokens(char** tokens);
+typedef struct LineBuffer
+{
+    char* data;         //< the current line, NUL terminated, without the trailing newline
+    size_t capacity;    //< size of the allocation behind data
+} LineBuffer;
 
 /**
- * @brief This function removes the quotes from a string. If the string is not quoted, it returns the same string. Otherwise, the current string is freed, and a pointer to the new string is returned.
+ * @brief Reads the next line from a stream into the buffer, removing the trailing newline.
  * 
- * @param str String to remove quotes from
- * @return char* Pointer to the new string
+ * @param stream The stream to read from
+ * @param buffer The buffer to read into. Initialize it to {NULL, 0} before the first read.
+ * @return ssize_t The length of the line, or -1 on EOF or error
  */
-char* removeQuotes(char* str);
+ssize_t readLine(FILE* stream, LineBuffer* buffer);
 
 /**
- * @brief Get the Tokens count
+ * @brief Frees the memory of a line buffer.
  * 
- * @param tokens The NULL terminated array of tokens
- * @return int Number of tokens in the array
+ * @param buffer The buffer to free
  */
-int getTokenCount(char** tokens);
+void freeLineBuffer(LineBuffer* buffer);
 
 #endif // UTILS_H
\ No newline at end of file
@@ -0,0 +1,95 @@
+/**
+ * @file variables.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief The shell's variables. Their values are kept in a hashtable (the one aliases use), and the names of the exported ones in another, since a variable can be exported before it is set. Exported variables are mirrored into the environment (with setenv/unsetenv) as they change, so that commands the shell starts see them.
+ * @version 0.1
+ * @date 2023-07-26
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef VARIABLES_H
+#define VARIABLES_H
+
+#include "utils.h"
+#include "output.h"
+
+/**
+ * @brief Sets up the variables, importing the environment as exported variables.
+ *
+ */
+void initVariables(void);
+
+/**
+ * @brief Frees the variables.
+ *
+ */
+void freeVariables(void);
+
+/**
+ * @brief Returns the value of a variable.
+ *
+ * @param name The name of the variable, which doesn't have to be NUL terminated
+ * @param length Length of the name
+ * @return const char* The value, or NULL if the variable is unset
+ */
+const char* getVariable(const char* name, size_t length);
+
+/**
+ * @brief Sets a variable. If it is exported, the environment is updated as well.
+ *
+ * @param name The name of the variable
+ * @param value The value
+ * @return int Status code (0 on success, -1 on failure)
+ */
+int setVariable(const char* name, const char* value);
+
+/**
+ * @brief Marks a variable as exported, and puts it in the environment if it is set.
+ *
+ * @param name The name of the variable
+ * @return int Status code (0 on success, -1 on failure)
+ */
+int exportVariable(const char* name);
+
+/**
+ * @brief Unsets a variable, removing it from the environment if it was exported.
+ *
+ * @param name The name of the variable
+ * @return int Status code (0 on success, -1 on failure)
+ */
+int unsetVariable(const char* name);
+
+/**
+ * @brief Prints the exported variables, as `export name='value'`.
+ *
+ * @param sink The sink to print to
+ */
+void printExportedVariables(OutputSink* sink);
+
+/**
+ * @brief Checks whether a string starts with a valid variable name, and returns its length.
+ *
+ * @param str The string
+ * @return size_t Length of the name at the start of the string, 0 if there's none
+ */
+size_t variableNameLength(const char* str);
+
+// ------------------------- Special parameters --------------------------------
+
+/**
+ * @brief Records the exit status of the last pipeline, for `$?`. Negative (internal failure) statuses are recorded as 1.
+ *
+ * @param status The status
+ */
+void setLastStatus(int status);
+
+/**
+ * @brief Returns the exit status of the last pipeline, i.e. `$?`.
+ *
+ * @return int The status
+ */
+int getLastStatus(void);
+
+#endif // VARIABLES_H
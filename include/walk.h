@@ -0,0 +1,63 @@
+/**
+ * @file walk.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Parallel walk of a directory tree, for recursive (`**`) patterns. A pool of threads reads the directories with openat/getdents64, every thread working through a deque of its own, stealing from the others when it runs out and sleeping while there's nothing to steal. The walk starts on the calling thread alone, and is only shared once enough directories are queued. The pool's threads are started by the first walk that is shared, and wait for the next one in between. The entries are merged and sorted afterwards, so the result doesn't depend on how the work was split.
+ * @version 0.1
+ * @date 2023-07-29
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef WALK_H
+#define WALK_H
+
+#include "utils.h"
+#include "arena.h"
+
+/**
+ * @brief An entry found by the walk.
+ *
+ */
+typedef struct WalkEntry
+{
+    const char* path;       //< path of the entry, relative to the root of the walk
+    unsigned char type;     //< DT_* type of the entry
+} WalkEntry;
+
+/**
+ * @brief The entries under a directory.
+ *
+ */
+typedef struct WalkResult
+{
+    WalkEntry* entries;     //< the entries, sorted by path with strcmp
+    size_t count;           //< number of entries
+    Arena* arenas;          //< the memory of the paths, one arena per thread of the walk
+    int nArenas;            //< number of arenas
+} WalkResult;
+
+/**
+ * @brief Finds every entry under a directory. Directories whose name starts with a '.' are listed, but not walked into, and symbolic links are never followed.
+ *
+ * @param root The directory to walk
+ * @param nThreads Number of threads to walk with, 0 for one per online CPU
+ * @param result Filled with the entries. Free it with freeWalkResult, even if the walk failed.
+ * @return int Status code (0 on success, -1 on failure)
+ */
+int walkTree(const char* root, int nThreads, WalkResult* result);
+
+/**
+ * @brief Frees the entries of a walk.
+ *
+ * @param result The result to free
+ */
+void freeWalkResult(WalkResult* result);
+
+/**
+ * @brief Stops the threads the walks are shared with. A later walk starts them again if it needs them.
+ *
+ */
+void stopWalkThreads(void);
+
+#endif // WALK_H
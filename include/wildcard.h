@@ -0,0 +1,84 @@
+/**
+ * @file wildcard.h
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief The shell's own pathname expansion, in place of libc glob. A pattern is matched one path component at a time, against directory listings that are kept between expansions and only read again when the directory's mtime changes, so expanding `*.log` in the same directory over and over reads it once. Words without `*`, `?` or `[` are never matched against anything, and a backslash makes the character after it an ordinary one, which is how the quoted parts of a word are kept from matching.
+ *
+ * The rules are the ones of glob with GLOB_NOCHECK | GLOB_TILDE: a leading `~` or `~user` is replaced by the home directory, names starting with '.' only match a pattern that starts with '.', the matches are sorted with strcmp, and a pattern that matches nothing expands to itself.
+ * @version 0.1
+ * @date 2023-07-28
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#ifndef WILDCARD_H
+#define WILDCARD_H
+
+#include "utils.h"
+#include "arena.h"
+
+#include <stdbool.h>
+
+/**
+ * @brief The paths a pattern expanded to.
+ *
+ */
+typedef struct GlobMatches
+{
+    char** paths;       //< the paths, sorted
+    size_t count;       //< number of paths
+    size_t capacity;    //< number of slots allocated for the paths array
+    Arena strings;      //< the memory of the paths
+} GlobMatches;
+
+/**
+ * @brief Checks whether a word has any wildcard characters in it, i.e. whether it is a pattern.
+ *
+ * @param word The word
+ * @return true If the word has `*`, `?` or `[` in it that isn't escaped with a backslash
+ */
+bool hasWildcards(const char* word);
+
+/**
+ * @brief Copies a word with the backslashes that escape its characters removed.
+ *
+ * @param to Where the word is copied to, which can be the word itself
+ * @param from The word
+ * @param length Length of the word
+ * @return size_t Length of the copy, which isn't NUL terminated
+ */
+size_t removeEscapes(char* to, const char* from, size_t length);
+
+/**
+ * @brief Matches a name against a pattern of a single path component.
+ *
+ * @param pattern The pattern, with `*`, `?` and bracket expressions (ranges, `!`/`^` negation and `[:class:]`). A backslash makes the character after it an ordinary one
+ * @param patternLength Length of the pattern, which doesn't have to be NUL terminated
+ * @param name The name
+ * @return true If the name matches
+ */
+bool matchWildcard(const char* pattern, size_t patternLength, const char* name);
+
+/**
+ * @brief Expands a word into the paths it matches. The matches are freed with freeGlobMatches, even if the expansion failed.
+ *
+ * @param word The word
+ * @param matches Filled with the paths, or with the (tilde expanded) word itself if it isn't a pattern or matches nothing
+ * @return int Status code (0 on success, -1 on failure)
+ */
+int expandGlob(const char* word, GlobMatches* matches);
+
+/**
+ * @brief Frees the paths of an expansion.
+ *
+ * @param matches The matches to free
+ */
+void freeGlobMatches(GlobMatches* matches);
+
+/**
+ * @brief Forgets all the directory listings kept for pattern matching.
+ *
+ */
+void clearDirectoryCache(void);
+
+#endif // WILDCARD_H
@@ -0,0 +1,124 @@
+/**
+ * @file arena.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the arena allocator declared in arena.h
+ * @version 0.1
+ * @date 2023-07-20
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "arena.h"
+
+// rounds a size up to the alignment of the arena's allocations
+#define ALIGN_UP(size) (((size) + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1))
+
+// adds a new block to the arena, big enough for at least the given size
+static ArenaBlock* addBlock(Arena* arena, size_t size)
+{
+    // blocks after the first one double, so a big line only needs a few of them
+    size_t blockSize = arena->blocks ? arena->blocks->size * 2 : arena->blockSize;
+    if (blockSize < size)
+        blockSize = ALIGN_UP(size);
+
+    ArenaBlock* block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + blockSize);
+    if (!block)
+    {
+        LOG_DEBUG("Failed to allocate an arena block of %zu bytes\n", blockSize);
+        return NULL;
+    }
+
+    block->next = arena->blocks;
+    block->size = blockSize;
+    block->used = 0;
+    arena->blocks = block;
+
+    return block;
+}
+
+void initArena(Arena* arena, size_t blockSize)
+{
+    arena->blocks = NULL;
+    arena->blockSize = ALIGN_UP(blockSize);
+}
+
+void* arenaAlloc(Arena* arena, size_t size)
+{
+    size = ALIGN_UP(size ? size : 1);
+
+    ArenaBlock* block = arena->blocks;
+    if (!block || block->size - block->used < size)
+    {
+        block = addBlock(arena, size);
+        if (!block)
+            return NULL;
+    }
+
+    void* memory = (char*)block->data + block->used;
+    block->used += size;
+
+    return memory;
+}
+
+void* arenaRealloc(Arena* arena, void* memory, size_t oldSize, size_t newSize)
+{
+    if (!memory)
+        return arenaAlloc(arena, newSize);
+
+    if (newSize <= oldSize)
+        return memory;
+
+    // the last allocation of the current block can simply be extended
+    ArenaBlock* block = arena->blocks;
+    size_t oldAligned = ALIGN_UP(oldSize ? oldSize : 1);
+    size_t newAligned = ALIGN_UP(newSize);
+    if ((char*)memory + oldAligned == (char*)block->data + block->used && block->size - block->used >= newAligned - oldAligned)
+    {
+        block->used += newAligned - oldAligned;
+        return memory;
+    }
+
+    void* grown = arenaAlloc(arena, newSize);
+    if (grown)
+        memcpy(grown, memory, oldSize);
+
+    return grown;
+}
+
+char* arenaStrdup(Arena* arena, const char* str)
+{
+    if (!str)
+        return NULL;
+
+    size_t length = strlen(str) + 1;
+    char* copy = (char*)arenaAlloc(arena, length);
+    if (copy)
+        memcpy(copy, str, length);
+
+    return copy;
+}
+
+void resetArena(Arena* arena)
+{
+    // give back every block but the first (oldest) one, which has the default size
+    while (arena->blocks && arena->blocks->next)
+    {
+        ArenaBlock* next = arena->blocks->next;
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+
+    if (arena->blocks)
+        arena->blocks->used = 0;
+}
+
+void destroyArena(Arena* arena)
+{
+    while (arena->blocks)
+    {
+        ArenaBlock* next = arena->blocks->next;
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+}
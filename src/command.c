@@ -9,55 +9,78 @@
  * 
  */
 
+#define _GNU_SOURCE  // for pipe2
+
 #include "command.h"
+#include "shell_builtins.h"
+#include "jobs.h"
+#include "expand.h"
+#include "lexer.h"
+#include "variables.h"
+#include "input.h"
+#include "spawn_server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
 
-// simple macro to check if this command is chained with a certain operator  with the last command(just a hack for readability)
-#define CHAINED_WITH(opr) (prevCommand ? (prevCommand->chainingOperator ? (strcmp(prevCommand->chainingOperator, opr) == 0) : 0) : 0)
 
 /*----------------------------------------------------------------------------------------*/
 
 /*-------------------------------Initializers--------------------------------------------*/
 
 // initializes a simple command with default values
-SimpleCommand* initSimpleCommand()
+SimpleCommand* initSimpleCommand(Arena* arena)
 {
-    SimpleCommand* simpleCommand = (SimpleCommand*) malloc(sizeof(SimpleCommand));
+    SimpleCommand* simpleCommand = (SimpleCommand*)arenaAlloc(arena, sizeof(SimpleCommand));
 
     if (!simpleCommand)
         return NULL;
     
+    simpleCommand->words         = NULL;
+    simpleCommand->nWords        = 0;
+    simpleCommand->wordsCapacity = 0;
     simpleCommand->commandName = NULL;
+    simpleCommand->assignments  = NULL;
+    simpleCommand->nAssignments = 0;
+    simpleCommand->environment  = NULL;
     simpleCommand->args        = NULL;
     simpleCommand->argc        = 0;
+    simpleCommand->capacity    = 0;
+    simpleCommand->inputFile   = NULL;
+    simpleCommand->outputFile  = NULL;
+    simpleCommand->append      = false;
     simpleCommand->inputFD     = STDIN_FD;
     simpleCommand->outputFD    = STDOUT_FD;
     simpleCommand->execute     = NULL;
     simpleCommand->pid         = -1;
+    simpleCommand->job         = NULL;
 
     return simpleCommand;
 }
 
 // initializes a command with default values
-Command* initCommand()
+Command* initCommand(Arena* arena)
 {
-    Command* command = (Command*)malloc(sizeof(Command));
+    Command* command = (Command*)arenaAlloc(arena, sizeof(Command));
 
     if (!command)
         return NULL;
 
     command->simpleCommands   = NULL;
     command->nSimpleCommands  = 0;
+    command->capacity         = 0;
     command->background       = false;
-    command->chainingOperator = NULL;
+    command->chainingOperator = CHAIN_NONE;
     command->next             = NULL;
 
     return command;
 }
 
 // initializes a command chain with default values
-CommandChain* initCommandChain()
+CommandChain* initCommandChain(Arena* arena)
 {
-    CommandChain* chain = (CommandChain*)malloc(sizeof(CommandChain));
+    CommandChain* chain = (CommandChain*)arenaAlloc(arena, sizeof(CommandChain));
 
     if (!chain)
         return NULL;
@@ -65,6 +88,10 @@ CommandChain* initCommandChain()
     chain->head = NULL;
     chain->tail = NULL;
 
+    chain->program       = NULL;
+    chain->programLength = 0;
+    chain->commands      = NULL;
+
     return chain;
 }
 
@@ -95,8 +122,31 @@ int addCommandToChain(CommandChain* chain, Command* command)
     return 0;
 }
 
+// grows an array in the arena to hold at least `needed` elements, doubling its capacity so that n appends cost O(n) copying in total
+static int growArray(Arena* arena, void** array, int* capacity, int needed, size_t elementSize)
+{
+    if (needed <= *capacity)
+        return 0;
+
+    int newCapacity = *capacity ? *capacity : 4;
+    while (newCapacity < needed)
+        newCapacity *= 2;
+
+    // when NULL ptr given, arenaRealloc behaves like arenaAlloc
+    void* temp = arenaRealloc(arena, *array, *capacity * elementSize, newCapacity * elementSize);
+    if (!temp)
+    {
+        LOG_DEBUG("Realloc error. Failed to reallocate memory for the array.\n");
+        return -1;
+    }
+
+    *array = temp;
+    *capacity = newCapacity;
+    return 0;
+}
+
 // adds a simpleCommand to the current command chain link
-int addSimpleCommand(Command* command, SimpleCommand* simpleCommand)
+int addSimpleCommand(Arena* arena, Command* command, SimpleCommand* simpleCommand)
 {
     if (!command)
     {
@@ -110,18 +160,8 @@ int addSimpleCommand(Command* command, SimpleCommand* simpleCommand)
         return -1;
     }
 
-    // we need to realloc the array containing the commands.
-    SimpleCommand** temp = (SimpleCommand**)realloc(command->simpleCommands, (command->nSimpleCommands + 1) * sizeof(SimpleCommand*));
-
-    if (!temp)
-    {
-        LOG_DEBUG("Realloc error. Failed to reallocate memory for the array.\n");
+    if (growArray(arena, (void**)&command->simpleCommands, &command->capacity, command->nSimpleCommands + 1, sizeof(SimpleCommand*)))
         return -1;
-    }
-
-    // update the pointer
-    command->simpleCommands = temp;
-    temp = NULL;
 
     // add the new command at the end.
     command->simpleCommands[command->nSimpleCommands] = simpleCommand;
@@ -132,8 +172,8 @@ int addSimpleCommand(Command* command, SimpleCommand* simpleCommand)
     return 0;
 }
 
-// pushes an arg to the simpleCommand's args array. makes sure the args array is always null terminated.
-int pushArgs(char* arg, SimpleCommand* simpleCommand)
+// makes room for `count` more args, plus the NULL terminator
+int reserveArgs(Arena* arena, SimpleCommand* simpleCommand, int count)
 {
     if (!simpleCommand)
     {
@@ -141,34 +181,80 @@ int pushArgs(char* arg, SimpleCommand* simpleCommand)
         return -1;
     }
 
-    // when NULL ptr given, realloc behaves like malloc
-    char** temp = (char**)realloc(simpleCommand->args, (simpleCommand->argc + 2) * sizeof(char*));
+    return growArray(arena, (void**)&simpleCommand->args, &simpleCommand->capacity, simpleCommand->argc + count + 1, sizeof(char*));
+}
+
+// pushes an arg to the simpleCommand's args array. makes sure the args array is always null terminated.
+int pushArgs(Arena* arena, char* arg, SimpleCommand* simpleCommand)
+{
+    if (reserveArgs(arena, simpleCommand, 1))
+        return -1;
 
-    if (!temp)
+    char* copy = arenaStrdup(arena, arg);
+    if (!copy)
     {
-        LOG_DEBUG("Realloc error. Failed to reallocate memory for the array.\n");
+        LOG_DEBUG("Failed to copy the argument into the arena.\n");
         return -1;
     }
 
-    simpleCommand->args = temp;
-    temp = NULL;
-
-    simpleCommand->args[simpleCommand->argc] = COPY(arg);
+    simpleCommand->args[simpleCommand->argc] = copy;
     simpleCommand->args[simpleCommand->argc + 1] = NULL;
     simpleCommand->argc++;
 
+    // the name shares the string with args[0]
     if (simpleCommand->argc == 1)
     {
-        simpleCommand->commandName = COPY(arg);
+        simpleCommand->commandName = copy;
     }
 
     return 0;
 }
 
-/*-------------------------------Command Execution functions------------------------------*/
+// pushes a word to the simpleCommand's words
+int pushWord(Arena* arena, const char* text, unsigned flags, SimpleCommand* simpleCommand)
+{
+    if (!simpleCommand)
+    {
+        LOG_DEBUG("Invalid simpleCommand passed. It's NULL\n");
+        return -1;
+    }
+
+    if (growArray(arena, (void**)&simpleCommand->words, &simpleCommand->wordsCapacity, simpleCommand->nWords + 1, sizeof(Word)))
+        return -1;
+
+    char* copy = arenaStrdup(arena, text);
+    if (!copy)
+    {
+        LOG_DEBUG("Failed to copy the word into the arena.\n");
+        return -1;
+    }
+
+    simpleCommand->words[simpleCommand->nWords].text = copy;
+    simpleCommand->words[simpleCommand->nWords].flags = flags;
+    simpleCommand->nWords++;
+
+    return 0;
+}
+
+// pushes a batch of args, with a single resize of the args array
+int pushArgsBulk(Arena* arena, char** args, int count, SimpleCommand* simpleCommand)
+{
+    if (reserveArgs(arena, simpleCommand, count))
+        return -1;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (pushArgs(arena, args[i], simpleCommand))
+            return -1;
+    }
+
+    return 0;
+}
+
+/*-------------------------------Compilation--------------------------------------------*/
 
-// executes a command chain
-int executeCommandChain(CommandChain* chain)
+// compiles a command chain into instructions. every command is an EXEC_PIPELINE, preceded by an instruction for the operator it is chained to the previous command with
+int compileCommandChain(Arena* arena, CommandChain* chain)
 {
     if (!chain)
     {
@@ -176,196 +262,331 @@ int executeCommandChain(CommandChain* chain)
         return -1;
     }
 
-    Command* command = chain->head;
-    Command* prevCommand = NULL;
-
-    // lastStatus is the exit status of the last command in the chain, used by logical chaining operators
-    int lastStatus = 0;
+    int nCommands = 0;
+    for (Command* command = chain->head; command; command = command->next)
+        nCommands++;
 
-    // always execute the first command in the chain
-    if (!command)
+    chain->commands = (Command**)arenaAlloc(arena, nCommands * sizeof(Command*));
+    chain->program = (Instruction*)arenaAlloc(arena, 2 * nCommands * sizeof(Instruction));
+    if (!chain->commands || !chain->program)
     {
-        LOG_DEBUG("Commmad chain is empty\n");
+        LOG_DEBUG("Failed to allocate memory for the compiled chain\n");
         return -1;
     }
 
-    lastStatus = executeCommand(command);
-
-    prevCommand = command;
-    command = command->next;
+    Instruction* program = chain->program;
+    int length = 0;
+    int index = 0;
+    ChainOperator previousOperator = CHAIN_NONE;
 
-    while (command)
+    for (Command* command = chain->head; command; command = command->next, index++)
     {
-        if (CHAINED_WITH("&&"))
+        // the jumps skip the EXEC_PIPELINE right after them
+        switch (previousOperator)
         {
-            // Only execute the current command if the previous command succeeded, else skip it
-            if (lastStatus == 0)
+        case CHAIN_AND:
+            program[length] = (Instruction){OP_JUMP_IF_FAIL, length + 2};
+            length++;
+            break;
+        case CHAIN_OR:
+            program[length] = (Instruction){OP_JUMP_IF_OK, length + 2};
+            length++;
+            break;
+        case CHAIN_SEQUENCE:
+            program[length] = (Instruction){OP_SEQ, 0};
+            length++;
+            break;
+        case CHAIN_NONE:
+            // the first command, or one that follows the end of the chain, which the parser never produces
+            if (index > 0)
             {
-                lastStatus = executeCommand(command);
+                LOG_DEBUG("Invalid chaining operator\n");
+                return -1;
             }
+            break;
         }
-        else if (CHAINED_WITH("||"))
-        {
-            // Only execute the current command if the previous command failed, else skip it
-            if (lastStatus != 0)
-            {
-                lastStatus = executeCommand(command);
-            }
-        }
-        else if (CHAINED_WITH(";"))
+
+        chain->commands[index] = command;
+        program[length] = (Instruction){OP_EXEC_PIPELINE, index};
+        length++;
+
+        previousOperator = command->chainingOperator;
+    }
+
+    chain->programLength = length;
+    return 0;
+}
+
+/*-------------------------------Command Execution functions------------------------------*/
+
+// opens the files a simple command is redirected to/from, replacing the descriptors it got from the pipes. they are close-on-exec, the stage that uses one gets it dup2'ed onto stdin/stdout, which clears the flag
+static int openRedirections(SimpleCommand* simpleCommand, Arena* arena)
+{
+    if (simpleCommand->inputFile)
+    {
+        // the file names can have parameters in them too
+        char* inputFile = expandString(arena, simpleCommand->inputFile);
+        int fileFD = inputFile ? open(inputFile, O_RDONLY | O_CLOEXEC) : -1;
+        if (fileFD == -1)
         {
-            // Always execute the current command
-            lastStatus = executeCommand(command);
+            LOG_ERROR("%s: %s\n", inputFile ? inputFile : simpleCommand->inputFile, strerror(errno));
+            return -1;
         }
-        else
+        simpleCommand->inputFD = fileFD;
+    }
+
+    if (simpleCommand->outputFile)
+    {
+        char* outputFile = expandString(arena, simpleCommand->outputFile);
+        int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (simpleCommand->append ? O_APPEND : O_TRUNC);
+        int fileFD = outputFile ? open(outputFile, flags, 0644) : -1;
+        if (fileFD == -1)
         {
-            LOG_DEBUG("Invalid chaining operator\n");
+            LOG_ERROR("%s: %s\n", outputFile ? outputFile : simpleCommand->outputFile, strerror(errno));
             return -1;
         }
-
-        // update the pointers
-        prevCommand = command;
-        command = command->next;
+        simpleCommand->outputFD = fileFD;
     }
 
-    return lastStatus;
+    return 0;
 }
 
-// executes a Command (with or without IO redirs)
-int executeCommand(Command* command)
+// sets the shell variables a simple command without a command name assigns
+static int applyAssignments(SimpleCommand* simpleCommand)
 {
-    if (!command)
+    int status = 0;
+    for (int i = 0; i < simpleCommand->nAssignments; i++)
     {
-        LOG_DEBUG("Invalid command passed\n");
-        return -1;
+        // the assignment is split at its '=' in place for a moment, the name and the value are both needed as strings
+        char* equals = strchr(simpleCommand->assignments[i], '=');
+        *equals = '\0';
+        if (setVariable(simpleCommand->assignments[i], equals + 1))
+        {
+            LOG_ERROR("%s: %s\n", simpleCommand->assignments[i], strerror(errno));
+            status = 1;
+        }
+        *equals = '=';
     }
 
-    // If the command is empty, return an error
-    if (!command->simpleCommands || command->nSimpleCommands == 0)
+    return status;
+}
+
+// runs a builtin in a child process of its job, so that it runs concurrently with the other stages of its pipeline (or in the background) instead of blocking the shell on a full pipe. the builtin's effects on the shell's state stay in the child, like in a subshell
+static int forkBuiltin(SimpleCommand* simpleCommand, int nextInputFD)
+{
+    // anything stdio still holds would be written by both processes otherwise
+    fflush(stdout);
+    // and the child reads stdin from where the shell's next line starts, if it reads the shell's stdin at all
+    if (simpleCommand->inputFD == STDIN_FD)
+        syncInput();
+
+    pid_t pid = fork();
+    if (pid == -1)
     {
-        LOG_DEBUG("Invalid command. It's empty\n");
-        return -1;
+        LOG_ERROR("fork: %s\n", strerror(errno));
+        return 1;
     }
 
-    for (int i = 0; i < command->nSimpleCommands; i++)
+    if (pid == 0)
     {
-        LOG_DEBUG("Executing command : %s\n", command->simpleCommands[i]->commandName);
-        SimpleCommand* simpleCommand = command->simpleCommands[i];
+        setUpJobProcess(simpleCommand->job);
+        detachSpawnServer();
+
+        // the shell holds the read end of the pipe this stage writes to, for the next stage. the child doesn't exec, so close-on-exec doesn't drop it, and holding it would keep the pipe from breaking once the reader exits
+        if (nextInputFD != STDIN_FD && nextInputFD != -1)
+            close(nextInputFD);
 
-        // If the command name is empty, return an error
-        if (!simpleCommand->commandName)
-        {
-            LOG_DEBUG("Invalid command name. It's empty\n");
-            return -1;
-        }
-        
-        // non-zero status means the command execution failed (both for built-in and external commands)
         int status = simpleCommand->execute(simpleCommand);
-        LOG_DEBUG("Command executing with pid: %d\n", simpleCommand->pid);
 
-        // If the command failed, return the status
-        if (status)
-        {
-            return status;
-        }
-        // if the command succeeded, simply close the file descriptors
-        if (simpleCommand->inputFD != STDIN_FD)
-            close(simpleCommand->inputFD);
-        
-        if (simpleCommand->outputFD != STDOUT_FD)
-            close(simpleCommand->outputFD);
+        // _exit skips stdio's exit handlers, and the builtin's messages would be lost with them
+        fflush(stdout);
+        fflush(stderr);
+        _exit(status < 0 ? 1 : status);
     }
 
+    simpleCommand->pid = pid;
+    addProcessToJob(simpleCommand->job, pid);
+
     return 0;
 }
 
-/*-------------------------------Clean up functions---------------------------------------*/
-
-// cleans up a simple command and frees memeory
-void cleanUpSimpleCommand(SimpleCommand* simpleCommand)
+// executes a command chain, by running its instructions
+int executeCommandChain(CommandChain* chain, Arena* arena, bool tail)
 {
-    if (!simpleCommand)
-        return;
-
-    LOG_DEBUG("Cleaning up simple command: %s\n", simpleCommand->commandName);
+    if (!chain || !chain->program)
+    {
+        LOG_DEBUG("Invalid command chain passed\n");
+        return -1;
+    }
 
-    // free the commandName. It was allocated with strdup, so this is the only pointer to that string. The source for the string was the input token, which is freed in the main loop.
-    if (simpleCommand->commandName)
+    if (chain->programLength == 0)
     {
-        free(simpleCommand->commandName);
-        simpleCommand->commandName = NULL;
+        LOG_DEBUG("Commmad chain is empty\n");
+        return -1;
     }
 
-    // free the args. They were allocated with strdup, so this is the only pointer to that string. The source for the string was the input token, which is freed in the main loop.
-    if (simpleCommand->args)
+    // the status of the last executed command, which the jumps test
+    int status = 0;
+    const Instruction* program = chain->program;
+
+    for (int pc = 0; pc < chain->programLength;)
     {
-        for (int i = 0; i < simpleCommand->argc; i++)
+        const Instruction* instruction = &program[pc];
+        switch (instruction->opcode)
         {
-            if (simpleCommand->args[i])
-            {
-                free(simpleCommand->args[i]);
-                simpleCommand->args[i] = NULL;
-            }
+        case OP_EXEC_PIPELINE:
+            // the last instruction is always an EXEC_PIPELINE, nothing runs after it
+            status = executeCommand(chain->commands[instruction->operand], arena, tail && pc == chain->programLength - 1);
+            setLastStatus(status);
+            pc++;
+            break;
+        case OP_JUMP_IF_FAIL:
+            pc = status != 0 ? instruction->operand : pc + 1;
+            break;
+        case OP_JUMP_IF_OK:
+            pc = status == 0 ? instruction->operand : pc + 1;
+            break;
+        case OP_SEQ:
+            pc++;
+            break;
         }
-
-        free(simpleCommand->args);
-        simpleCommand->args = NULL;
     }
 
-    // free the  simpleCommand
-    free(simpleCommand);
-    simpleCommand = NULL;
+    return status;
 }
 
-// cleans up a command
-void cleanUpCommand(Command* command)
+// executes a Command (with or without IO redirs)
+int executeCommand(Command* command, Arena* arena, bool tail)
 {
     if (!command)
-        return;
+    {
+        LOG_DEBUG("Invalid command passed\n");
+        return -1;
+    }
 
-    // free the simpleCommands
-    if (command->simpleCommands)
+    // If the command is empty, return an error
+    if (!command->simpleCommands || command->nSimpleCommands == 0)
     {
-        for (int i = 0; i < command->nSimpleCommands; i++)
+        LOG_DEBUG("Invalid command. It's empty\n");
+        return -1;
+    }
+
+    // the words of every stage are expanded into its args first, the job needs them for its command line. a stage whose words couldn't be expanded (e.g. an alias with a syntax error in it) fails, instead of running with the args it got so far
+    bool* expansionFailed = (bool*)arenaAlloc(arena, command->nSimpleCommands * sizeof(bool));
+    if (!expansionFailed)
+    {
+        LOG_DEBUG("Failed to allocate memory for the expansion status\n");
+        return -1;
+    }
+
+    for (int i = 0; i < command->nSimpleCommands; i++)
+    {
+        SimpleCommand* simpleCommand = command->simpleCommands[i];
+        expansionFailed[i] = expandSimpleCommand(arena, simpleCommand) != 0;
+        if (expansionFailed[i])
         {
-            cleanUpSimpleCommand(command->simpleCommands[i]);
+            // named by the word in command position, after any assignments
+            int nameIndex = simpleCommand->nAssignments < simpleCommand->nWords ? simpleCommand->nAssignments : 0;
+            LOG_ERROR("%s: Failed to expand the command\n", simpleCommand->nWords ? simpleCommand->words[nameIndex].text : "");
         }
     }
 
-    free(command->simpleCommands);
-
-    // free the chainingOperator, it was allocated with strndup
-    if (command->chainingOperator)
+    // every pipeline gets a job, so that its processes share a process group. a pipeline of builtins only never starts a process, and its job is dropped right away
+    Job* job = createJob(command);
+    if (!job)
     {
-        free(command->chainingOperator);
-        command->chainingOperator = NULL;
+        LOG_DEBUG("Failed to allocate memory for job\n");
+        return -1;
     }
 
-    // don't need to free the next and current command, they will be handled by the chain cleanup
-}
+    // status of the last stage, which is the status of the whole pipeline
+    int status = 0;
 
-// clean up the command chain linked list
-void cleanUpCommandChain(CommandChain* chain)
-{
-    if (!chain)
-        return;
+    // read end of the pipe from the previous stage to the current one. the parser makes sure a stage that reads from a pipe has no input file, and one that writes to a pipe no output file, so pipe ends are never replaced by files
+    int nextInputFD = STDIN_FD;
 
-    // free the commands
-    if (chain->head)
+    // start every stage of the pipeline before waiting on any of them, so that the stages run concurrently and a stage writing more than a pipe buffer doesn't block forever on a reader that hasn't been started yet
+    for (int i = 0; i < command->nSimpleCommands; i++)
     {
-        Command* command = chain->head;
-        while (command)
+        LOG_DEBUG("Executing command : %s\n", command->simpleCommands[i]->commandName);
+        SimpleCommand* simpleCommand = command->simpleCommands[i];
+        simpleCommand->job = job;
+
+        // the stage reads from the pipe the previous stage writes to, and writes to a new pipe if there's a next stage. the pipe is close-on-exec, so that the stages of a pipeline don't inherit each other's pipe ends
+        simpleCommand->inputFD = nextInputFD;
+        simpleCommand->outputFD = STDOUT_FD;
+        nextInputFD = STDIN_FD;
+
+        int pipeFD[2];
+        if (i < command->nSimpleCommands - 1)
         {
-            Command* nextCommand = command->next;
-            cleanUpCommand(command);
-            free(command);
-            command = nextCommand;
+            if (pipe2(pipeFD, O_CLOEXEC) == -1)
+            {
+                LOG_ERROR("pipe: %s\n", strerror(errno));
+                pipeFD[PIPE_READ_END] = pipeFD[PIPE_WRITE_END] = -1;
+            }
+            simpleCommand->outputFD = pipeFD[PIPE_WRITE_END];
+            nextInputFD = pipeFD[PIPE_READ_END];
         }
+
+        // If the descriptors couldn't be opened, the stage can't be started. We still continue, so that the rest of the pipeline gets its descriptors closed and is reaped properly
+        if (expansionFailed[i] || simpleCommand->inputFD == -1 || simpleCommand->outputFD == -1 || openRedirections(simpleCommand, arena) == -1)
+        {
+            status = 1;
+        }
+        else if (!simpleCommand->commandName)
+        {
+            // only assignments (or words that expanded to nothing). the variables are set in the shell when the command is on its own, in a pipeline or in the background they'd be set in a subshell, and are dropped
+            LOG_DEBUG("Simple command without a command name\n");
+            status = command->nSimpleCommands == 1 && !command->background ? applyAssignments(simpleCommand) : 0;
+        }
+        else if (simpleCommand->execute != executeProcess && (command->nSimpleCommands > 1 || command->background))
+        {
+            // builtins that are part of a pipeline or run in the background get a process of their own
+            status = forkBuiltin(simpleCommand, nextInputFD);
+        }
+        else if (tail && simpleCommand->execute == executeProcess && command->nSimpleCommands == 1 && !command->background)
+        {
+            // the shell has nothing left to do once the command is done, so the command takes over the shell's process instead of being started as its child. this only returns if the exec failed
+            status = replaceShell(simpleCommand, simpleCommand->args);
+        }
+        else
+        {
+            // a builtin on its own runs to completion in the shell and returns its status. external commands are only started, their status is collected when the job is waited on below
+            status = simpleCommand->execute(simpleCommand);
+            LOG_DEBUG("Command executing with pid: %d\n", simpleCommand->pid);
+        }
+
+        // the stage now owns its descriptors (or is done with them), so the shell closes its copies. this is what lets the next stage see EOF once the writer exits
+        if (simpleCommand->inputFD != STDIN_FD && simpleCommand->inputFD != -1)
+            close(simpleCommand->inputFD);
+
+        if (simpleCommand->outputFD != STDOUT_FD && simpleCommand->outputFD != -1)
+            close(simpleCommand->outputFD);
+    }
+
+    if (job->nProcesses == 0)
+    {
+        removeJob(job);
+        return status;
     }
 
-    // free the chain
-    free(chain);
-    chain = NULL;
+    if (command->background)
+    {
+        reportBackgroundJob(job);
+        return 0;
+    }
+
+    // reap all the stages that were started as child processes. the exit status of a pipeline is the exit status of its last stage, which may have been a builtin
+    int jobStatus = waitForJob(job);
+    if (command->simpleCommands[command->nSimpleCommands - 1]->pid != -1 || getJobState(job) == JOB_STOPPED)
+        status = jobStatus;
+
+    // a stopped job stays in the table, so that it can be continued with fg or bg
+    if (getJobState(job) == JOB_DONE)
+        removeJob(job);
+
+    return status;
 }
 
 /*-------------------------------Utility functions----------------------------------------*/
@@ -395,15 +616,14 @@ void printSimpleCommand(SimpleCommand* simpleCommand)
     if (!simpleCommand)
         return;
 
-    LOG_DEBUG("-- name: %s\n", simpleCommand->commandName);
-    LOG_DEBUG("-- args:\n");
-    for (int i = 0; i < simpleCommand->argc; i++)
+    LOG_DEBUG("-- words:\n");
+    for (int i = 0; i < simpleCommand->nWords; i++)
     {
-        LOG_DEBUG("-- -- %s \n", simpleCommand->args[i]);
+        LOG_DEBUG("-- -- %s%s\n", simpleCommand->words[i].text, simpleCommand->words[i].flags & TOKEN_QUOTED ? " (quoted)" : "");
     }
 
-    LOG_DEBUG("-- Input FD: %d\n", simpleCommand->inputFD);
-    LOG_DEBUG("-- Output FD: %d\n", simpleCommand->outputFD);
+    LOG_DEBUG("-- Input file: %s\n", simpleCommand->inputFile ? simpleCommand->inputFile : "(none)");
+    LOG_DEBUG("-- Output file: %s%s\n", simpleCommand->outputFile ? simpleCommand->outputFile : "(none)", simpleCommand->append ? " (append)" : "");
     LOG_DEBUG("--------------------\n");
 }
 
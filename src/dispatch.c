@@ -0,0 +1,130 @@
+/**
+ * @file dispatch.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the builtin dispatch table declared in dispatch.h
+ * @version 0.1
+ * @date 2023-07-14
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "dispatch.h"
+
+// the table gets this many slots per name (rounded up to a power of two). sparse enough that a collision free seed is found in a handful of tries
+#define SLOTS_PER_NAME 4
+
+// seeds tried for a table size before it is doubled, and the number of doublings before the table gives up on hashing and the names are scanned instead
+#define MAX_SEEDS 256
+#define MAX_GROWTHS 4
+
+// Seeded hash function for strings (FNV-1a)
+static inline unsigned long hashName(const char *str, unsigned long seed)
+{
+    unsigned long hash = 14695981039346656037UL ^ seed;
+    int c;
+
+    while ((c = (unsigned char)*str++))
+    {
+        hash ^= c;
+        hash *= 1099511628211UL;
+    }
+
+    return hash ^ (hash >> 29);
+}
+
+// tries seeds until every name gets a slot of its own in a table of the given size. the expected number of tries is small and the result only depends on the registry, so the table is the same on every run. returns -1 if none of the seeds tried is collision free
+static int findSeed(DispatchTable *table, const CommandRegistry *registry, unsigned long count, unsigned long size)
+{
+    table->mask = size - 1;
+    for (table->seed = 0; table->seed < MAX_SEEDS; table->seed++)
+    {
+        memset(table->slots, 0, size * sizeof(CommandRegistry *));
+
+        unsigned long i;
+        for (i = 0; i < count; i++)
+        {
+            const CommandRegistry **slot = &table->slots[hashName(registry[i].commandName, table->seed) & table->mask];
+            if (*slot)
+                break;
+            *slot = &registry[i];
+        }
+
+        if (i == count)
+            return 0;
+    }
+
+    return -1;
+}
+
+int buildDispatchTable(DispatchTable *table, const CommandRegistry *registry)
+{
+    table->slots = NULL;
+    table->registry = NULL;
+
+    // two names can never get slots of their own if they are the same name
+    unsigned long count = 0;
+    for (; registry[count].commandName; count++)
+    {
+        for (unsigned long j = 0; j < count; j++)
+        {
+            if (strcmp(registry[j].commandName, registry[count].commandName) == 0)
+            {
+                LOG_ERROR("Builtin %s is registered twice\n", registry[count].commandName);
+                return -1;
+            }
+        }
+    }
+
+    unsigned long size = 1;
+    while (size < count * SLOTS_PER_NAME)
+        size <<= 1;
+
+    // a registry that no seed works for gets a bigger table
+    for (int growths = 0; growths <= MAX_GROWTHS; growths++, size <<= 1)
+    {
+        table->slots = (const CommandRegistry **)calloc(size, sizeof(CommandRegistry *));
+        if (!table->slots)
+            return -1;
+
+        if (findSeed(table, registry, count, size) == 0)
+        {
+            LOG_DEBUG("Dispatch table: %lu names, %lu slots, seed %lu\n", count, size, table->seed);
+            table->registry = registry;
+            return 0;
+        }
+
+        free(table->slots);
+        table->slots = NULL;
+    }
+
+    LOG_DEBUG("Dispatch table: no seed found for %lu names, falling back to a linear lookup\n", count);
+    table->registry = registry;
+    return 0;
+}
+
+const CommandRegistry *lookupDispatchTable(const DispatchTable *table, const char *name)
+{
+    if (!table->slots)
+    {
+        for (const CommandRegistry *entry = table->registry; entry->commandName; entry++)
+        {
+            if (strcmp(entry->commandName, name) == 0)
+                return entry;
+        }
+        return NULL;
+    }
+
+    const CommandRegistry *entry = table->slots[hashName(name, table->seed) & table->mask];
+
+    if (entry && strcmp(entry->commandName, name) == 0)
+        return entry;
+
+    return NULL;
+}
+
+void freeDispatchTable(DispatchTable *table)
+{
+    free(table->slots);
+    table->slots = NULL;
+}
@@ -0,0 +1,567 @@
+/**
+ * @file expand.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the word expansion declared in expand.h
+ * @version 0.1
+ * @date 2023-07-24
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "expand.h"
+#include "lexer.h"
+#include "hashtable.h"
+#include "shell_builtins.h"
+#include "variables.h"
+#include "jobs.h"
+
+#include "wildcard.h"
+
+// fields are split on these when IFS is unset
+#define DEFAULT_IFS " \t\n"
+
+extern hashtable* aliases;
+extern char** environ;
+
+/*-------------------------------Parameters-------------------------------------------*/
+
+// a string that the expansion of a word is built in
+typedef struct ExpansionBuffer
+{
+    char* data;
+    size_t length;
+    size_t capacity;
+} ExpansionBuffer;
+
+static int appendText(ExpansionBuffer* buffer, const char* text, size_t length)
+{
+    if (buffer->length + length + 1 > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity : 64;
+        while (capacity < buffer->length + length + 1)
+            capacity *= 2;
+
+        char* data = (char*)realloc(buffer->data, capacity);
+        if (!data)
+        {
+            LOG_DEBUG("Realloc error. Failed to reallocate memory for the expansion.\n");
+            return -1;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return 0;
+}
+
+// appends text from a word, with its escapes removed
+static int appendUnescaped(ExpansionBuffer* buffer, const char* text, size_t length)
+{
+    size_t start = buffer->length;
+    if (appendText(buffer, text, length))
+        return -1;
+    buffer->length = start + removeEscapes(buffer->data + start, buffer->data + start, length);
+    buffer->data[buffer->length] = '\0';
+    return 0;
+}
+
+// appends the value of an expansion to a field, escaping the characters in it that mustn't be special to pathname expansion
+static int appendEscaped(ExpansionBuffer* buffer, const char* value, size_t length, const char* special)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if ((strchr(special, value[i]) && appendText(buffer, "\\", 1)) || appendText(buffer, value + i, 1))
+            return -1;
+    }
+    return 0;
+}
+
+// the value of a special parameter, formatted into number if it's numeric. NULL if it is unset
+static const char* specialParameter(char name, char number[static 24])
+{
+    switch (name)
+    {
+    case '?':
+        snprintf(number, 24, "%d", getLastStatus());
+        return number;
+    case '$':
+        // words are only expanded by the shell process itself, never by a child
+        snprintf(number, 24, "%d", (int)getpid());
+        return number;
+    case '!':
+        if (!lastBackgroundPid)
+            return NULL;
+        snprintf(number, 24, "%d", lastBackgroundPid);
+        return number;
+    case '#':
+        return "0";
+    default:
+        // positional parameters, the shell never has any
+        return NULL;
+    }
+}
+
+// returned by expandParameter for a parameter that can't be expanded
+#define BAD_PARAMETER ((size_t)-1)
+
+static int expandText(const char* text, ExpansionBuffer* buffer);
+
+// finds the '}' that closes a `${`, skipping the `${...}` nested in its word. NULL if there's none
+static const char* findClosingBrace(const char* p)
+{
+    int depth = 0;
+    for (; *p; p++)
+    {
+        if ((*p == EXPAND_UNQUOTED || *p == EXPAND_QUOTED) && p[1] == '{')
+        {
+            depth++;
+            p++;
+        }
+        else if (*p == '}' && depth-- == 0)
+        {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// expands the word of a `${name<op>word}` into the buffer. the word isn't NUL terminated
+static int expandParameterWord(const char* word, size_t length, ExpansionBuffer* buffer)
+{
+    char* copy = strndup(word, length);
+    if (!copy)
+        return -1;
+
+    buffer->length = 0;
+    int status = expandText(copy, buffer);
+    free(copy);
+    return status;
+}
+
+// reads the parameter after a '$' (`name`, a special parameter, or either in braces, where it can be followed by an operator and a word, as in `${name:-word}`), and works out its value. a word is only expanded if it is used, into the word buffer, which the value may point into. returns the number of characters the parameter takes, 0 if there's no parameter and the '$' is literal, or BAD_PARAMETER if it can't be expanded (the error has been reported)
+static size_t expandParameter(const char* p, const char** value, char number[static 24], ExpansionBuffer* word)
+{
+    *value = NULL;
+    bool braces = *p == '{';
+    const char* name = p + braces;
+
+    size_t length = variableNameLength(name);
+    bool special = false;
+    if (length)
+        *value = getVariable(name, length);
+    else if (*name && strchr("?$!#0123456789", *name))
+        *value = specialParameter(*name, number), length = 1, special = true;
+    else if (!braces)
+        return 0;
+
+    if (!braces)
+        return length;
+
+    const char* operator = name + length;
+    if (length && *operator == '}')
+        return length + 2;
+
+    // ${name-word}, ${name=word}, ${name+word} and ${name?word}, which with a ':' before the operator treat an empty value like an unset one
+    const char* end = findClosingBrace(operator);
+    bool colon = *operator == ':';
+    char op = operator[colon];
+    if (!length || !end || !op || !strchr("-=+?", op))
+    {
+        LOG_ERROR("Bad substitution\n");
+        return BAD_PARAMETER;
+    }
+
+    const char* wordStart = operator + colon + 1;
+    size_t wordLength = end - wordStart;
+    bool set = *value && !(colon && !**value);
+
+    switch (op)
+    {
+    case '-':
+        if (!set)
+        {
+            if (expandParameterWord(wordStart, wordLength, word))
+                return BAD_PARAMETER;
+            *value = word->data;
+        }
+        break;
+    case '=':
+        if (!set)
+        {
+            if (special)
+            {
+                LOG_ERROR("%.*s: cannot assign in this way\n", (int)length, name);
+                return BAD_PARAMETER;
+            }
+
+            char* variable = strndup(name, length);
+            int status = variable && expandParameterWord(wordStart, wordLength, word) == 0 ? setVariable(variable, word->data) : -1;
+            free(variable);
+            if (status)
+                return BAD_PARAMETER;
+            *value = word->data;
+        }
+        break;
+    case '+':
+        *value = NULL;
+        if (set)
+        {
+            if (expandParameterWord(wordStart, wordLength, word))
+                return BAD_PARAMETER;
+            *value = word->data;
+        }
+        break;
+    default:
+        // '?', the command fails with the word as its error
+        if (!set)
+        {
+            if (expandParameterWord(wordStart, wordLength, word))
+                return BAD_PARAMETER;
+            const char* message = word->length ? word->data : (colon ? "parameter null or not set" : "parameter not set");
+            LOG_ERROR("%.*s: %s\n", (int)length, name, message);
+
+            // only an interactive shell carries on, a script or a -c string is abandoned with status 2, like in other shells
+            if (mode != INTERACTIVE_MODE)
+                terminateShell(2);
+            return BAD_PARAMETER;
+        }
+        break;
+    }
+
+    return end - p + 1;
+}
+
+// expands the parameters of a text into the buffer, without splitting it
+static int expandText(const char* text, ExpansionBuffer* buffer)
+{
+    ExpansionBuffer word = {NULL, 0, 0};
+    int status = 0;
+
+    for (const char* p = text; *p && status == 0;)
+    {
+        size_t literal = strcspn(p, "\x01\x02");
+        if (appendUnescaped(buffer, p, literal))
+        {
+            status = -1;
+            break;
+        }
+        p += literal;
+        if (!*p)
+            break;
+
+        const char* value;
+        char number[24];
+        size_t length = expandParameter(++p, &value, number, &word);
+        if (length == BAD_PARAMETER)
+        {
+            status = -1;
+        }
+        else if (!length)
+        {
+            status = appendText(buffer, "$", 1);
+        }
+        else
+        {
+            if (value)
+                status = appendText(buffer, value, strlen(value));
+            p += length;
+        }
+    }
+
+    free(word.data);
+
+    // the buffer always ends up with a string, even for an empty text
+    return status ? status : appendText(buffer, "", 0);
+}
+
+char* expandString(Arena* arena, const char* text)
+{
+    if (!strpbrk(text, "\x01\x02\\"))
+        return (char*)text;
+
+    ExpansionBuffer buffer = {NULL, 0, 0};
+    char* result = expandText(text, &buffer) == 0 ? arenaStrdup(arena, buffer.data) : NULL;
+    free(buffer.data);
+    return result;
+}
+
+/*-------------------------------Words------------------------------------------------*/
+
+// pushes the paths a wildcard pattern matches, or the word itself if it isn't a pattern or matches nothing
+static int expandWildcards(Arena* arena, const char* word, SimpleCommand* simpleCommand)
+{
+    GlobMatches matches;
+    if (expandGlob(word, &matches))
+    {
+        LOG_DEBUG("Failed to expand glob\n");
+        freeGlobMatches(&matches);
+        return -1;
+    }
+
+    // the args array is grown once for all of them
+    int status = pushArgsBulk(arena, matches.paths, matches.count, simpleCommand);
+
+    freeGlobMatches(&matches);
+    return status;
+}
+
+// pushes a field of an expanded word, which is a wildcard pattern whose quoted characters are escaped. most fields have neither unescaped wildcards nor a leading ~, and are pushed as they are, without going through the glob engine's matches
+static int pushField(Arena* arena, const char* field, SimpleCommand* simpleCommand)
+{
+    if (field[0] == '~' || hasWildcards(field))
+        return expandWildcards(arena, field, simpleCommand);
+
+    if (pushArgs(arena, (char*)field, simpleCommand))
+        return -1;
+
+    // the escapes are removed from the arg's own copy
+    char* arg = simpleCommand->args[simpleCommand->argc - 1];
+    size_t length = strlen(arg);
+    arg[removeEscapes(arg, arg, length)] = '\0';
+    return 0;
+}
+
+// expands the parameters of a word, and pushes the fields it's split into. the results of unquoted expansions are split on IFS, everything else sticks to the field it is in
+static int splitFields(Arena* arena, const char* text, unsigned flags, SimpleCommand* simpleCommand)
+{
+    const char* ifs = getVariable("IFS", 3);
+    if (!ifs)
+        ifs = DEFAULT_IFS;
+
+    ExpansionBuffer field = {NULL, 0, 0};
+    ExpansionBuffer word = {NULL, 0, 0};
+    bool started = false;
+    int nFields = 0;
+    int status = appendText(&field, "", 0);
+
+    for (const char* p = text; *p && status == 0;)
+    {
+        if (*p != EXPAND_UNQUOTED && *p != EXPAND_QUOTED)
+        {
+            size_t literal = strcspn(p, "\x01\x02");
+            status = appendText(&field, p, literal);
+            started = true;
+            p += literal;
+            continue;
+        }
+
+        bool quoted = *p++ == EXPAND_QUOTED;
+        const char* value;
+        char number[24];
+        size_t length = expandParameter(p, &value, number, &word);
+        if (length == BAD_PARAMETER)
+        {
+            status = -1;
+            break;
+        }
+        if (!length)
+        {
+            status = appendText(&field, "$", 1);
+            started = true;
+            continue;
+        }
+        p += length;
+
+        if (quoted)
+        {
+            // even an empty quoted expansion makes a field
+            started = true;
+            if (value)
+                status = appendEscaped(&field, value, strlen(value), QUOTED_ESCAPES);
+            continue;
+        }
+
+        for (const char* v = value; v && *v && status == 0; v++)
+        {
+            if (!strchr(ifs, *v))
+            {
+                // the wildcards of an unquoted expansion are still wildcards, its backslashes and tildes are not special
+                status = appendEscaped(&field, v, 1, "\\~");
+                started = true;
+            }
+            else if (started)
+            {
+                status = pushField(arena, field.data, simpleCommand);
+                field.length = 0;
+                field.data[0] = '\0';
+                started = false;
+                nFields++;
+            }
+        }
+    }
+
+    // a word with quotes in it is a field even if nothing is left of it, like ""
+    if (status == 0 && (started || (nFields == 0 && (flags & TOKEN_QUOTED))))
+        status = pushField(arena, field.data, simpleCommand);
+
+    free(field.data);
+    free(word.data);
+    return status;
+}
+
+// pushes the args a word expands to, without alias expansion
+static int expandWord(Arena* arena, const char* text, unsigned flags, SimpleCommand* simpleCommand)
+{
+    if (flags & TOKEN_EXPAND)
+        return splitFields(arena, text, flags, simpleCommand);
+    return pushField(arena, text, simpleCommand);
+}
+
+// an alias being expanded. the aliases being expanded form a stack, and an alias is not expanded again inside its own expansion
+typedef struct AliasFrame
+{
+    const char* name;
+    const struct AliasFrame* outer;
+} AliasFrame;
+
+static bool isExpanding(const AliasFrame* frame, const char* name)
+{
+    for (; frame; frame = frame->outer)
+    {
+        if (strcmp(frame->name, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// pushes the args a word in command position expands to. if it is an alias, the first word of its value is in command position too, and so on. checkNext is set if the word after this one is also checked for an alias, which is the case when the value ends with a blank
+static int expandCommandWord(Arena* arena, const char* text, unsigned flags, SimpleCommand* simpleCommand, const AliasFrame* expanding, bool* checkNext)
+{
+    *checkNext = false;
+
+    // words with quotes or parameters in them are never aliases
+    const TokenList* tokens = NULL;
+    if (!(flags & (TOKEN_QUOTED | TOKEN_EXPAND)) && !isExpanding(expanding, text))
+        tokens = getTokens(aliases, text);
+
+    if (!tokens)
+        return expandWord(arena, text, flags, simpleCommand);
+
+    if (tokens->error)
+    {
+        LOG_ERROR("Syntax error: %s\n", tokens->error);
+        return -1;
+    }
+
+    // the value was tokenized once, when the alias was first used. its words are pushed from the tokens the table keeps
+    AliasFrame frame = {text, expanding};
+    bool check = true;
+    int status = reserveArgs(arena, simpleCommand, tokens->count);
+    for (int i = 0; i < tokens->count && status == 0; i++)
+    {
+        if (check)
+        {
+            status = expandCommandWord(arena, TOKEN_TEXT(tokens, i), tokens->tokens[i].flags, simpleCommand, &frame, &check);
+        }
+        else
+        {
+            status = expandWord(arena, TOKEN_TEXT(tokens, i), tokens->tokens[i].flags, simpleCommand);
+        }
+    }
+
+    // an empty value leaves the next word in command position
+    const char* value = get(aliases, text);
+    size_t length = strlen(value);
+    *checkNext = check || (length > 0 && (value[length - 1] == ' ' || value[length - 1] == '\t'));
+
+    return status;
+}
+
+// builds the environment of a process from the shell's, with the assignments of its command added to it
+static char** buildEnvironment(Arena* arena, SimpleCommand* simpleCommand)
+{
+    int count = 0;
+    while (environ[count])
+        count++;
+
+    char** environment = (char**)arenaAlloc(arena, (count + simpleCommand->nAssignments + 1) * sizeof(char*));
+    if (!environment)
+        return NULL;
+
+    int length = 0;
+    for (int i = 0; i < count; i++)
+    {
+        // variables the command assigns are left out, the assignments replace them
+        size_t nameLength = strcspn(environ[i], "=");
+        bool assigned = false;
+        for (int j = 0; j < simpleCommand->nAssignments && !assigned; j++)
+            assigned = strncmp(simpleCommand->assignments[j], environ[i], nameLength + 1) == 0;
+
+        if (!assigned)
+            environment[length++] = environ[i];
+    }
+
+    for (int j = 0; j < simpleCommand->nAssignments; j++)
+        environment[length++] = simpleCommand->assignments[j];
+    environment[length] = NULL;
+
+    return environment;
+}
+
+int expandSimpleCommand(Arena* arena, SimpleCommand* simpleCommand)
+{
+    simpleCommand->commandName = NULL;
+    simpleCommand->args = NULL;
+    simpleCommand->argc = 0;
+    simpleCommand->capacity = 0;
+    simpleCommand->execute = NULL;
+    simpleCommand->environment = NULL;
+
+    // the assignments come before the command name
+    int nAssignments = 0;
+    while (nAssignments < simpleCommand->nWords && (simpleCommand->words[nAssignments].flags & TOKEN_ASSIGNMENT))
+        nAssignments++;
+
+    simpleCommand->nAssignments = nAssignments;
+    simpleCommand->assignments = nAssignments ? (char**)arenaAlloc(arena, nAssignments * sizeof(char*)) : NULL;
+    if (nAssignments && !simpleCommand->assignments)
+        return -1;
+
+    for (int i = 0; i < nAssignments; i++)
+    {
+        // the value of an assignment is never split or matched against paths
+        simpleCommand->assignments[i] = expandString(arena, simpleCommand->words[i].text);
+        if (!simpleCommand->assignments[i])
+            return -1;
+    }
+
+    // the alias only needs to be expanded when its used as a command, and not as an argument to a command. the exception is the word after an alias whose value ends with a blank
+    bool checkAlias = true;
+    for (int i = nAssignments; i < simpleCommand->nWords; i++)
+    {
+        Word* word = &simpleCommand->words[i];
+        int status;
+
+        if (checkAlias)
+        {
+            status = expandCommandWord(arena, word->text, word->flags, simpleCommand, NULL, &checkAlias);
+        }
+        else
+        {
+            status = expandWord(arena, word->text, word->flags, simpleCommand);
+        }
+
+        if (status)
+        {
+            LOG_DEBUG("Failed to push argument to simple command\n");
+            return -1;
+        }
+    }
+
+    if (simpleCommand->commandName)
+        simpleCommand->execute = getExecutionFunction(simpleCommand->commandName);
+
+    // only a process gets the assignments in its environment (exec's included), builtins ignore them
+    if (nAssignments && (simpleCommand->execute == executeProcess || simpleCommand->execute == execCommand))
+    {
+        simpleCommand->environment = buildEnvironment(arena, simpleCommand);
+        if (!simpleCommand->environment)
+            return -1;
+    }
+
+    return 0;
+}
@@ -1,147 +1,238 @@
 #include "hashtable.h"
 
-// Hash function for strings (djb2)
-static unsigned long hash(const char *str)
+// the table grows when it gets more than 3/4 full
+#define MAX_LOAD(capacity) ((capacity) / 4 * 3)
+
+// Hash function for strings (djb2), which also measures the string
+static unsigned hash(const char *str, size_t *length)
 {
-    unsigned long hash = 5381;
+    unsigned hash = 5381;
+    const char *p = str;
     int c;
 
-    while ((c = *str++))
+    while ((c = (unsigned char)*p++))
     {
         hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
     }
 
+    *length = p - str - 1;
+    return hash;
+}
+
+// the same hash, for a key of known length that doesn't have to be NUL terminated
+static unsigned hashLength(const char *str, size_t length)
+{
+    unsigned hash = 5381;
+    for (size_t i = 0; i < length; i++)
+        hash = ((hash << 5) + hash) + (unsigned char)str[i];
     return hash;
 }
 
-// creates a new entry
-static struct htEntry *createEntry(const char *key, const char *value)
+// the key of an entry
+static inline const char *entryKey(const htEntry *entry)
 {
-    struct htEntry *entry = (struct htEntry *)malloc(sizeof(struct htEntry));
-    if (entry)
+    return entry->longKey ? entry->longKey : entry->inlineKey;
+}
+
+// finds the slot of a key: its own slot if it is in the table, else the empty slot it would go in
+static htEntry *findSlot(htEntry *entries, size_t capacity, const char *key, size_t length, unsigned keyHash)
+{
+    size_t mask = capacity - 1;
+    for (size_t i = keyHash & mask;; i = (i + 1) & mask)
     {
-        entry->key = COPY(key);
-        entry->value = COPY(value);
-        entry->next = NULL;
+        htEntry *entry = &entries[i];
+        if (!entry->value)
+            return entry;
+        // the cached hash and length rule out almost every other key without touching its string
+        if (entry->hash == keyHash && entry->keyLength == length && memcmp(entryKey(entry), key, length) == 0)
+            return entry;
     }
-    return entry;
 }
 
-// traverses the linked list and returns the entry with the given key
-static struct htEntry *getEntry(struct linkedList *list, const char *key)
+// doubles the number of slots, moving the entries with their cached hashes
+static int growHashtable(hashtable *table)
 {
-    struct htEntry *curr = list->head;
-    while (curr != NULL)
+    size_t capacity = table->capacity * 2;
+    htEntry *entries = (htEntry *)calloc(capacity, sizeof(htEntry));
+    if (!entries)
     {
-        if (strcmp(curr->key, key) == 0)
-        {
-            return curr;
-        }
-        curr = curr->next;
+        LOG_DEBUG("Failed to allocate memory for the hashtable\n");
+        return -1;
     }
-    return NULL;
+
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        htEntry *entry = &table->entries[i];
+        if (entry->value)
+            *findSlot(entries, capacity, entryKey(entry), entry->keyLength, entry->hash) = *entry;
+    }
+
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+    return 0;
 }
 
-void cleanUpEntry(struct htEntry *entry)
+// drops the tokens of an entry's value
+static void dropTokens(htEntry *entry)
 {
-    if (!entry)
+    if (!entry->tokens)
         return;
 
-    if (entry->key)
-        free(entry->key);
-    if (entry->value)
-        free(entry->value);
-    free(entry);
+    freeTokenList(entry->tokens);
+    free(entry->tokens);
+    entry->tokens = NULL;
+}
+
+// frees what an entry holds, and empties its slot
+static void clearEntry(htEntry *entry)
+{
+    dropTokens(entry);
+    free(entry->value);
+    free(entry->longKey);
+    memset(entry, 0, sizeof(htEntry));
 }
 
-// insert a new entry into the linked list
-static void insertEntry(struct linkedList *list, struct htEntry *entry)
+// the set function for the hashtable
+int set(struct hashtable *table, const char *key, const char *value)
 {
-    if (list->head == NULL)
+    if (!value)
     {
-        list->head = entry;
-        list->tail = entry;
+        removeKey(table, key);
+        return 0;
     }
-    else
+
+    char *copy = COPY(value);
+    if (!copy)
+        return -1;
+
+    size_t length;
+    unsigned keyHash = hash(key, &length);
+
+    if (table->count + 1 > MAX_LOAD(table->capacity) && growHashtable(table))
     {
-        list->tail->next = entry;
-        list->tail = entry;
+        free(copy);
+        return -1;
     }
-}
 
-// traverses the linked list and sets the entry with the given key to the given value, if the key exists, else it creates a new entry
-static void setEntry(struct linkedList *list, const char *key, const char *value)
-{
-    struct htEntry *entry = getEntry(list, key);
-    if (entry)
+    htEntry *entry = findSlot(table->entries, table->capacity, key, length, keyHash);
+    if (entry->value)
     {
-        if (entry->value)
-            free(entry->value);
-        entry->value = COPY(value);
+        // the tokens were made from the old value
+        dropTokens(entry);
+        free(entry->value);
+        entry->value = copy;
+        return 0;
+    }
+
+    if (length >= HT_INLINE_KEY)
+    {
+        entry->longKey = COPY(key);
+        if (!entry->longKey)
+        {
+            free(copy);
+            return -1;
+        }
     }
     else
     {
-        entry = createEntry(key, value);
-        if (entry)
-            insertEntry(list, entry);
+        memcpy(entry->inlineKey, key, length + 1);
     }
+
+    entry->hash = keyHash;
+    entry->keyLength = length;
+    entry->value = copy;
+    table->count++;
+    return 0;
+}
+
+// the get function for the hashtable
+char *get(struct hashtable *table, const char *key)
+{
+    size_t length;
+    unsigned keyHash = hash(key, &length);
+    return findSlot(table->entries, table->capacity, key, length, keyHash)->value;
 }
 
-// clean up a linked list
-static void cleanUpList(struct linkedList *list)
+// the get function, for a key that isn't NUL terminated
+char *getn(struct hashtable *table, const char *key, size_t length)
 {
-    if (!list)
-        return;
-    
-    struct htEntry *curr = list->head;
-    while (curr != NULL)
-    {
-        struct htEntry *next = curr->next;
-        cleanUpEntry(curr);
-        curr = next;
-    }
-    free(list);
+    return findSlot(table->entries, table->capacity, key, length, hashLength(key, length))->value;
 }
 
-// the set function for the hashtable
-void set(struct hashtable *table, const char *key, const char *value)
+// returns the tokens of a key's value, tokenizing it the first time
+const TokenList *getTokens(struct hashtable *table, const char *key)
 {
-    int index = hash(key) % table->size;
-    setEntry(table->buckets[index], key, value);
+    size_t length;
+    unsigned keyHash = hash(key, &length);
+    htEntry *entry = findSlot(table->entries, table->capacity, key, length, keyHash);
+    if (!entry->value)
+        return NULL;
+
+    if (!entry->tokens)
+    {
+        entry->tokens = (TokenList *)malloc(sizeof(TokenList));
+        if (!entry->tokens)
+            return NULL;
+
+        // a value that fails to tokenize keeps its list too, with the error in it
+        *entry->tokens = (TokenList){NULL, 0, NULL, 0, NULL};
+        tokenize(entry->value, entry->tokens);
+    }
+
+    return entry->tokens;
 }
 
-// the get function for the hashtable
-char *get(struct hashtable *table, const char *key)
+// removes a key, shifting the entries of its probe run back into the hole so that lookups never stop early at it
+int removeKey(struct hashtable *table, const char *key)
 {
-    int index = hash(key) % table->size;
-    struct htEntry *entry = getEntry(table->buckets[index], key);
-    if (entry)
-        return entry->value;
-    
-    return NULL;
+    size_t length;
+    unsigned keyHash = hash(key, &length);
+    htEntry *entry = findSlot(table->entries, table->capacity, key, length, keyHash);
+    if (!entry->value)
+        return -1;
+
+    clearEntry(entry);
+    table->count--;
+
+    size_t mask = table->capacity - 1;
+    size_t hole = entry - table->entries;
+    for (size_t i = (hole + 1) & mask; table->entries[i].value; i = (i + 1) & mask)
+    {
+        // an entry can only move back to the hole if the hole is between its home slot and where it is now
+        size_t home = table->entries[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            table->entries[hole] = table->entries[i];
+            memset(&table->entries[i], 0, sizeof(htEntry));
+            hole = i;
+        }
+    }
+
+    return 0;
 }
 
 // creates a new hashtable
 struct hashtable *createHashtable(int size)
 {
     struct hashtable *table = (struct hashtable *)malloc(sizeof(struct hashtable));
-    if (table)
+    if (!table)
+        return NULL;
+
+    // enough slots for size entries below the maximum load
+    size_t capacity = HASHTABLE_INITIAL_CAPACITY;
+    while (MAX_LOAD(capacity) < (size_t)(size > 0 ? size : 0))
+        capacity *= 2;
+
+    table->entries = (htEntry *)calloc(capacity, sizeof(htEntry));
+    if (!table->entries)
     {
-        table->size = size;
-        table->buckets = (struct linkedList **)malloc(sizeof(struct linkedList *) * size);
-        if (table->buckets)
-        {
-            for (int i = 0; i < size; i++)
-            {
-                table->buckets[i] = (struct linkedList *)malloc(sizeof(struct linkedList));
-                if (table->buckets[i])
-                {
-                    table->buckets[i]->head = NULL;
-                    table->buckets[i]->tail = NULL;
-                }
-            }
-        }
+        free(table);
+        return NULL;
     }
+
+    table->capacity = capacity;
+    table->count = 0;
     return table;
 }
 
@@ -151,30 +242,36 @@ void deleteHashtable(struct hashtable *table)
     if (!table)
         return;
     
-    for (int i = 0; i < table->size; i++)
+    for (size_t i = 0; i < table->capacity; i++)
     {
-        cleanUpList(table->buckets[i]);
+        if (table->entries[i].value)
+            clearEntry(&table->entries[i]);
     }
-    free(table->buckets);
+    free(table->entries);
     free(table);
+}
 
-    table = NULL;
+// calls the function for every entry
+void forEachEntry(struct hashtable *table, void (*visit)(const char *key, const char *value, void *context), void *context)
+{
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        const htEntry *entry = &table->entries[i];
+        if (entry->value)
+            visit(entryKey(entry), entry->value, context);
+    }
 }
 
 // prints the hashtable
-void printHashtable(struct hashtable *table)
+void printHashtable(struct hashtable *table, OutputSink *sink)
 {
     if (!table)
         return;
     
-    for (int i = 0; i < table->size; i++)
+    for (size_t i = 0; i < table->capacity; i++)
     {
-        struct htEntry *curr = table->buckets[i]->head;
-        while (curr != NULL)
-        {
-            if (curr->value)
-                printf("%s=\'%s\'\n", curr->key, curr->value);
-            curr = curr->next;
-        }
+        const htEntry *entry = &table->entries[i];
+        if (entry->value)
+            sinkPrintf(sink, "%s=\'%s\'\n", entryKey(entry), entry->value);
     }
-}
\ No newline at end of file
+}
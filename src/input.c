@@ -0,0 +1,162 @@
+/**
+ * @file input.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the input reader declared in input.h
+ * @version 0.1
+ * @date 2023-07-30
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "input.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+// size of the blocks seekable input is read in
+#define INPUT_BLOCK_SIZE (64 * 1024)
+
+// the input. buffer[start, end) has been read from the file descriptor, but not returned as lines yet
+static int inputFD = -1;
+static bool seekable = false;
+static char* buffer = NULL;
+static size_t start = 0;
+static size_t end = 0;
+
+void initInput(int fd)
+{
+    inputFD = fd;
+    seekable = lseek(fd, 0, SEEK_CUR) != -1;
+    start = end = 0;
+}
+
+// makes room for a line of the given length, plus the NUL terminator
+static int reserveLine(LineBuffer* line, size_t length)
+{
+    if (length + 1 <= line->capacity)
+        return 0;
+
+    size_t capacity = line->capacity ? line->capacity : 128;
+    while (capacity < length + 1)
+        capacity *= 2;
+
+    char* data = (char*)realloc(line->data, capacity);
+    if (!data)
+    {
+        LOG_DEBUG("Realloc error. Failed to reallocate memory for the line.\n");
+        return -1;
+    }
+    line->data = data;
+    line->capacity = capacity;
+    return 0;
+}
+
+// reads from the input, retrying when a signal interrupts the read
+static ssize_t readInput(void* into, size_t size)
+{
+    ssize_t nread;
+    do
+        nread = read(inputFD, into, size);
+    while (nread == -1 && errno == EINTR);
+
+    return nread;
+}
+
+// reads a line a byte at a time, so that none of the input after it is consumed
+static ssize_t readUnbuffered(LineBuffer* line)
+{
+    size_t length = 0;
+    char c;
+    ssize_t nread;
+    while ((nread = readInput(&c, 1)) == 1 && c != '\n')
+    {
+        if (reserveLine(line, length + 1))
+            return -1;
+        line->data[length++] = c;
+    }
+
+    // EOF (or an error) with nothing read
+    if (nread != 1 && length == 0)
+        return -1;
+
+    if (reserveLine(line, length))
+        return -1;
+    line->data[length] = '\0';
+    return length;
+}
+
+// reads a line through the block buffer
+static ssize_t readBuffered(LineBuffer* line)
+{
+    if (!buffer)
+    {
+        buffer = (char*)malloc(INPUT_BLOCK_SIZE);
+        if (!buffer)
+        {
+            LOG_DEBUG("Failed to allocate memory for the input buffer\n");
+            return -1;
+        }
+    }
+
+    // the part of the line that was read so far, for lines longer than what's left in the buffer
+    size_t length = 0;
+    while (true)
+    {
+        char* newline = (char*)memchr(buffer + start, '\n', end - start);
+        size_t chunk = newline ? (size_t)(newline - (buffer + start)) : end - start;
+
+        if (reserveLine(line, length + chunk))
+            return -1;
+        memcpy(line->data + length, buffer + start, chunk);
+        length += chunk;
+        start += chunk;
+
+        if (newline)
+        {
+            start++;
+            break;
+        }
+
+        start = end = 0;
+        ssize_t nread = readInput(buffer, INPUT_BLOCK_SIZE);
+        if (nread <= 0)
+        {
+            // a last line without a newline is still a line
+            if (length == 0)
+                return -1;
+            break;
+        }
+        end = nread;
+    }
+
+    line->data[length] = '\0';
+    return length;
+}
+
+ssize_t readInputLine(LineBuffer* line)
+{
+    if (inputFD == -1)
+        return -1;
+
+    return seekable ? readBuffered(line) : readUnbuffered(line);
+}
+
+void syncInput(void)
+{
+    if (!seekable || start == end)
+        return;
+
+    // the next read starts from wherever the child leaves the offset
+    if (lseek(inputFD, -(off_t)(end - start), SEEK_CUR) == -1)
+        LOG_DEBUG("Failed to seek the input back: %s\n", strerror(errno));
+    start = end = 0;
+}
+
+void freeInput(void)
+{
+    free(buffer);
+    buffer = NULL;
+    start = end = 0;
+}
@@ -0,0 +1,877 @@
+/**
+ * @file jobs.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the job table declared in jobs.h
+ * @version 0.1
+ * @date 2023-07-10
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "jobs.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// most events handled per epoll_wait
+#define MAX_EVENTS 16
+
+// how often jobs are polled in a wait with a deadline, when there's no event loop
+#define POLL_INTERVAL_NS (10 * 1000 * 1000)
+
+// the job table, ordered by creation
+static Job* jobsHead = NULL;
+static Job* jobsTail = NULL;
+
+// the terminal the shell hands to foreground jobs, -1 if the shell doesn't control a terminal
+static int terminalFD = -1;
+static int shellPgid = 0;
+static bool interactiveShell = false;
+
+// set by the SIGCHLD handler, checked by reapJobs
+static volatile sig_atomic_t childStatusChanged = 0;
+
+// the event loop jobs are waited in: an epoll instance with the shell's signalfd in it, and the pidfds of the processes being waited on while a wait lasts. it is opened by the first wait, and a forked builtin opens its own instead of sharing its parent's. epollFD is -1 when the loop isn't open
+static int epollFD = -1;
+static int signalFD = -1;
+static pid_t eventLoopOwner = 0;
+
+// signals sent to the shell itself while it waits. they're not for the shell, but for the job it's waiting on, which doesn't get them when it's in a process group of its own, or when they were sent to the shell alone
+static const int forwardedSignals[] = {SIGINT, SIGQUIT, SIGTERM, SIGHUP};
+
+int lastBackgroundPid = 0;
+
+/*-------------------------------Helpers--------------------------------------------------*/
+
+// SIGCHLD handler, only records that something happened. the actual reaping is done outside of signal context, by reapJobs
+static void sigchldHandler(int signal)
+{
+    (void)signal;
+    childStatusChanged = 1;
+}
+
+// converts a wait status to the exit status reported by the shell
+static int toExitStatus(int status)
+{
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    if (WIFSTOPPED(status))
+        return 128 + WSTOPSIG(status);
+    return WEXITSTATUS(status);
+}
+
+// finds the process with the given pid in the job table
+static Process* findProcess(int pid)
+{
+    for (Job* job = jobsHead; job; job = job->next)
+    {
+        for (int i = 0; i < job->nProcesses; i++)
+        {
+            if (job->processes[i].pid == pid)
+                return &job->processes[i];
+        }
+    }
+    return NULL;
+}
+
+// records a status reported by waitpid
+static void markProcessStatus(int pid, int status)
+{
+    Process* process = findProcess(pid);
+    if (!process)
+    {
+        LOG_DEBUG("Reaped unknown child %d\n", pid);
+        return;
+    }
+
+    if (WIFSTOPPED(status))
+    {
+        process->state = JOB_STOPPED;
+        process->status = toExitStatus(status);
+    }
+    else if (WIFCONTINUED(status))
+    {
+        process->state = JOB_RUNNING;
+    }
+    else
+    {
+        process->state = JOB_DONE;
+        process->status = toExitStatus(status);
+    }
+    LOG_DEBUG("Process %d changed state to %d (status %d)\n", pid, process->state, process->status);
+}
+
+// builds the text shown for a job, e.g. `ls -l | grep a`
+static char* buildCommandLine(Command* command)
+{
+    size_t length = 1;
+    for (int i = 0; i < command->nSimpleCommands; i++)
+    {
+        for (int j = 0; j < command->simpleCommands[i]->argc; j++)
+            length += strlen(command->simpleCommands[i]->args[j]) + 1;
+        length += 2;
+    }
+
+    char* line = malloc(length);
+    if (!line)
+        return NULL;
+
+    char* end = line;
+    for (int i = 0; i < command->nSimpleCommands; i++)
+    {
+        if (i > 0)
+            end = stpcpy(end, "| ");
+
+        for (int j = 0; j < command->simpleCommands[i]->argc; j++)
+        {
+            end = stpcpy(end, command->simpleCommands[i]->args[j]);
+            end = stpcpy(end, " ");
+        }
+    }
+
+    // drop the trailing space
+    if (end > line)
+        end--;
+    *end = '\0';
+
+    return line;
+}
+
+// gives the terminal to a process group
+static void giveTerminalTo(int pgid)
+{
+    if (terminalFD != -1 && tcsetpgrp(terminalFD, pgid) == -1)
+        LOG_DEBUG("tcsetpgrp: %s\n", strerror(errno));
+}
+
+// sends a signal to the processes of a job. a job in the shell's own process group is signalled process by process, so that the shell doesn't get it as well
+static int signalJob(Job* job, int signo)
+{
+    if (job->pgid != shellPgid)
+        return kill(-job->pgid, signo);
+
+    int status = 0;
+    for (int i = 0; i < job->nProcesses; i++)
+    {
+        if (job->processes[i].state != JOB_DONE && kill(job->processes[i].pid, signo) == -1)
+            status = -1;
+    }
+    return status;
+}
+
+/*-------------------------------Event loop----------------------------------------------*/
+
+// the signals the event loop takes through the signalfd. they are blocked while a wait lasts, so that they're only ever read from it
+static void getLoopSignals(sigset_t* signals)
+{
+    sigemptyset(signals);
+    sigaddset(signals, SIGCHLD);
+    for (size_t i = 0; i < sizeof(forwardedSignals) / sizeof(forwardedSignals[0]); i++)
+        sigaddset(signals, forwardedSignals[i]);
+}
+
+static void closeEventLoop(void)
+{
+    if (epollFD != -1)
+        close(epollFD);
+    if (signalFD != -1)
+        close(signalFD);
+    epollFD = signalFD = -1;
+}
+
+// opens the event loop of this process, if it isn't open yet
+static int openEventLoop(void)
+{
+    if (epollFD != -1 && eventLoopOwner == getpid())
+        return 0;
+
+    // inherited from the shell by a forked builtin
+    closeEventLoop();
+
+    // pidfds need Linux 5.3
+    int pidfd = syscall(SYS_pidfd_open, getpid(), 0);
+    if (pidfd == -1)
+    {
+        LOG_DEBUG("pidfd_open: %s\n", strerror(errno));
+        return -1;
+    }
+    close(pidfd);
+
+    sigset_t signals;
+    getLoopSignals(&signals);
+    epollFD = epoll_create1(EPOLL_CLOEXEC);
+    signalFD = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    // the signalfd is the event without a process
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epollFD == -1 || signalFD == -1 || epoll_ctl(epollFD, EPOLL_CTL_ADD, signalFD, &event) == -1)
+    {
+        LOG_DEBUG("Failed to open the event loop: %s\n", strerror(errno));
+        closeEventLoop();
+        return -1;
+    }
+
+    eventLoopOwner = getpid();
+    return 0;
+}
+
+// a process being waited on, and its pidfd. the pidfd becomes readable once the process has exited
+typedef struct WaitedProcess
+{
+    Process* process;
+    int pidfd;
+} WaitedProcess;
+
+static bool anyJobRunning(Job** jobs, int nJobs)
+{
+    for (int i = 0; i < nJobs; i++)
+    {
+        if (getJobState(jobs[i]) == JOB_RUNNING)
+            return true;
+    }
+    return false;
+}
+
+// collects the processes of a job that stopped. exits are collected through the pidfds instead
+static void collectStops(Job* job)
+{
+    while (job->pgid)
+    {
+        siginfo_t info;
+        info.si_pid = 0;
+        if (waitid(P_PGID, job->pgid, &info, WSTOPPED | WNOHANG) == -1 || info.si_pid == 0)
+            break;
+        markProcessStatus(info.si_pid, W_STOPCODE(info.si_status));
+    }
+}
+
+// reaps a process whose pidfd is readable, and drops the pidfd (which takes it out of the epoll instance)
+static void collectExit(WaitedProcess* waited)
+{
+    int status;
+    if (waitpid(waited->process->pid, &status, WNOHANG) > 0)
+        markProcessStatus(waited->process->pid, status);
+    else if (waited->process->state == JOB_RUNNING)
+        waited->process->state = JOB_DONE;
+
+    close(waited->pidfd);
+    waited->pidfd = -1;
+}
+
+// reads the signals that came in, and forwards the ones for the shell to the foreground jobs. returns the last signal for the shell, 0 if there was none. forwarded is set if it was passed on to a job
+static int readSignals(Job** jobs, int nJobs, bool* forwarded)
+{
+    int received = 0;
+    struct signalfd_siginfo info;
+    while (read(signalFD, &info, sizeof(info)) == sizeof(info))
+    {
+        if (info.ssi_signo == SIGCHLD)
+        {
+            // background jobs outside of this wait changed state too, reapJobs has to look at them
+            childStatusChanged = 1;
+            for (int i = 0; i < nJobs; i++)
+                collectStops(jobs[i]);
+            continue;
+        }
+
+        received = info.ssi_signo;
+        for (int i = 0; i < nJobs; i++)
+        {
+            if (jobs[i]->foreground && jobs[i]->pgid && getJobState(jobs[i]) == JOB_RUNNING)
+            {
+                // the terminal sends its signals to the whole foreground group, so a job in the shell's group already has it
+                if (jobs[i]->pgid != shellPgid || info.ssi_code != SI_KERNEL)
+                    signalJob(jobs[i], received);
+                *forwarded = true;
+            }
+        }
+    }
+    return received;
+}
+
+// waits on a job with waitpid, for when the event loop can't be opened (a kernel without pidfds)
+static void waitForJobBlocking(Job* job)
+{
+    while (getJobState(job) == JOB_RUNNING)
+    {
+        int status;
+        int pid = waitpid(-job->pgid, &status, WUNTRACED);
+        if (pid == -1)
+        {
+            if (errno == EINTR)
+                continue;
+
+            // nothing left to wait for in the group, so whatever we haven't seen is gone
+            LOG_DEBUG("waitpid: %s\n", strerror(errno));
+            for (int i = 0; i < job->nProcesses; i++)
+            {
+                if (job->processes[i].state != JOB_DONE)
+                    job->processes[i].state = JOB_DONE;
+            }
+            break;
+        }
+
+        markProcessStatus(pid, status);
+    }
+}
+
+static long nowMilliseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000L + now.tv_nsec / 1000000;
+}
+
+// waits on jobs with a deadline when the event loop can't be opened. waitpid can't time out, so the jobs are polled until they're done or the deadline passes. returns 1 if it did
+static int pollJobs(Job** jobs, int nJobs, int timeout)
+{
+    long deadline = nowMilliseconds() + timeout;
+    while (anyJobRunning(jobs, nJobs))
+    {
+        if (nowMilliseconds() >= deadline)
+            return 1;
+
+        for (int i = 0; i < nJobs; i++)
+        {
+            int status;
+            int pid;
+            while (getJobState(jobs[i]) == JOB_RUNNING && (pid = waitpid(-jobs[i]->pgid, &status, WNOHANG | WUNTRACED)) != 0)
+            {
+                if (pid > 0)
+                {
+                    markProcessStatus(pid, status);
+                    continue;
+                }
+                if (errno == EINTR)
+                    continue;
+
+                // nothing left to wait for in the group
+                for (int j = 0; j < jobs[i]->nProcesses; j++)
+                    jobs[i]->processes[j].state = JOB_DONE;
+            }
+        }
+
+        nanosleep(&(struct timespec){0, POLL_INTERVAL_NS}, NULL);
+    }
+    return 0;
+}
+
+int awaitJobs(Job** jobs, int nJobs, int timeout)
+{
+    if (openEventLoop())
+    {
+        if (timeout >= 0)
+            return pollJobs(jobs, nJobs, timeout);
+
+        for (int i = 0; i < nJobs; i++)
+            waitForJobBlocking(jobs[i]);
+        return 0;
+    }
+
+    int nRunning = 0;
+    for (int i = 0; i < nJobs; i++)
+    {
+        for (int j = 0; j < jobs[i]->nProcesses; j++)
+            nRunning += jobs[i]->processes[j].state == JOB_RUNNING;
+    }
+    if (nRunning == 0)
+        return 0;
+
+    WaitedProcess* waited = (WaitedProcess*)malloc(nRunning * sizeof(WaitedProcess));
+    if (!waited)
+    {
+        LOG_DEBUG("Failed to allocate memory for the waited processes\n");
+        return 0;
+    }
+
+    // from here on, SIGCHLD and the signals for the shell are only read from the signalfd
+    sigset_t loopSignals;
+    sigset_t savedMask;
+    getLoopSignals(&loopSignals);
+    sigprocmask(SIG_BLOCK, &loopSignals, &savedMask);
+
+    int nWaited = 0;
+    for (int i = 0; i < nJobs; i++)
+    {
+        for (int j = 0; j < jobs[i]->nProcesses; j++)
+        {
+            Process* process = &jobs[i]->processes[j];
+            if (process->state != JOB_RUNNING)
+                continue;
+
+            // a process that can't be opened was already reaped, or isn't our child (a forked builtin's copy of the job table)
+            int pidfd = syscall(SYS_pidfd_open, process->pid, 0);
+            if (pidfd == -1)
+            {
+                process->state = JOB_DONE;
+                continue;
+            }
+
+            waited[nWaited] = (WaitedProcess){process, pidfd};
+            struct epoll_event event = {.events = EPOLLIN, .data.ptr = &waited[nWaited]};
+            if (epoll_ctl(epollFD, EPOLL_CTL_ADD, pidfd, &event) == -1)
+                LOG_DEBUG("epoll_ctl: %s\n", strerror(errno));
+            nWaited++;
+        }
+    }
+
+    // stops that happened before SIGCHLD was blocked only went to the handler
+    for (int i = 0; i < nJobs; i++)
+        collectStops(jobs[i]);
+
+    // only the processes that are ready are looked at, however many are running
+    long deadline = timeout >= 0 ? nowMilliseconds() + timeout : 0;
+    int result = 0;
+    int received = 0;
+    bool forwarded = false;
+    while (result == 0 && anyJobRunning(jobs, nJobs))
+    {
+        int remaining = -1;
+        if (timeout >= 0)
+        {
+            long left = deadline - nowMilliseconds();
+            if (left <= 0)
+            {
+                result = 1;
+                break;
+            }
+            remaining = (int)left;
+        }
+
+        struct epoll_event events[MAX_EVENTS];
+        int nEvents = epoll_wait(epollFD, events, MAX_EVENTS, remaining);
+        if (nEvents == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            LOG_DEBUG("epoll_wait: %s\n", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < nEvents; i++)
+        {
+            WaitedProcess* process = (WaitedProcess*)events[i].data.ptr;
+            if (process)
+            {
+                collectExit(process);
+                continue;
+            }
+
+            int signo = readSignals(jobs, nJobs, &forwarded);
+            if (signo)
+                received = signo;
+
+            // a signal no job could take, e.g. while `wait` waits on background jobs, ends the wait
+            if (signo && !forwarded)
+                result = 128 + signo;
+        }
+    }
+
+    for (int i = 0; i < nWaited; i++)
+    {
+        if (waited[i].pidfd != -1)
+            close(waited[i].pidfd);
+    }
+    free(waited);
+    sigprocmask(SIG_SETMASK, &savedMask, NULL);
+
+    // an interactive shell stays up, but a script is ended by the signal once its job is done, the same as if it had no job to pass it on to
+    if (received && (!interactiveShell || received == SIGHUP))
+    {
+        signal(received, SIG_DFL);
+        raise(received);
+    }
+
+    return result;
+}
+
+/*-------------------------------Setup---------------------------------------------------*/
+
+void initJobControl(bool interactive)
+{
+    interactiveShell = interactive;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sigchldHandler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+
+    shellPgid = getpgrp();
+
+    if (!isatty(STDIN_FD))
+        return;
+
+    if (interactive)
+    {
+        // wait until we're in the foreground, then take our own process group and the terminal
+        while (tcgetpgrp(STDIN_FD) != (shellPgid = getpgrp()))
+            kill(-shellPgid, SIGTTIN);
+
+        // ^C and ^\ at the prompt are for the foreground job, not the shell. readline leaves an ignored signal alone
+        signal(SIGINT, SIG_IGN);
+        signal(SIGQUIT, SIG_IGN);
+        signal(SIGTSTP, SIG_IGN);
+        signal(SIGTTIN, SIG_IGN);
+        signal(SIGTTOU, SIG_IGN);
+
+        shellPgid = getpid();
+        if (getpgrp() != shellPgid && setpgid(shellPgid, shellPgid) == -1)
+        {
+            LOG_DEBUG("setpgid: %s\n", strerror(errno));
+            return;
+        }
+
+        terminalFD = STDIN_FD;
+        giveTerminalTo(shellPgid);
+    }
+}
+
+void cleanUpJobs(void)
+{
+    while (jobsHead)
+        removeJob(jobsHead);
+
+    if (eventLoopOwner == getpid())
+        closeEventLoop();
+}
+
+/*-------------------------------Launching-----------------------------------------------*/
+
+Job* createJob(Command* command)
+{
+    Job* job = (Job*)malloc(sizeof(Job));
+    if (!job)
+        return NULL;
+
+    // without job control (a script), the processes stay in the shell's process group, as POSIX has it, so that the terminal's signals reach them and the shell alike
+    job->id          = jobsTail ? jobsTail->id + 1 : 1;
+    job->pgid        = interactiveShell ? 0 : shellPgid;
+    job->processes   = NULL;
+    job->nProcesses  = 0;
+    job->capacity    = 0;
+    job->foreground  = !command->background;
+    job->notified    = false;
+    job->commandLine = buildCommandLine(command);
+    job->next        = NULL;
+
+    if (!jobsHead)
+        jobsHead = job;
+    else
+        jobsTail->next = job;
+    jobsTail = job;
+
+    return job;
+}
+
+int addProcessToJob(Job* job, int pid)
+{
+    if (job->nProcesses == job->capacity)
+    {
+        int capacity = job->capacity ? job->capacity * 2 : 4;
+        Process* temp = (Process*)realloc(job->processes, capacity * sizeof(Process));
+        if (!temp)
+        {
+            LOG_DEBUG("Realloc error. Failed to reallocate memory for the array.\n");
+            return -1;
+        }
+        job->processes = temp;
+        job->capacity = capacity;
+    }
+
+    job->processes[job->nProcesses].pid = pid;
+    job->processes[job->nProcesses].status = 0;
+    job->processes[job->nProcesses].state = JOB_RUNNING;
+    job->nProcesses++;
+
+    if (!job->foreground)
+        lastBackgroundPid = pid;
+    if (!isJobInOwnGroup(job))
+        return 0;
+
+    // the first process leads the group. the child does the same setpgid, whichever of the two runs first wins the race
+    if (!job->pgid)
+        job->pgid = pid;
+    if (setpgid(pid, job->pgid) == -1 && errno != EACCES)
+        LOG_DEBUG("setpgid: %s\n", strerror(errno));
+
+    if (job->foreground)
+        giveTerminalTo(job->pgid);
+
+    return 0;
+}
+
+void setUpJobProcess(Job* job)
+{
+    if (job && isJobInOwnGroup(job))
+    {
+        // the child's copy of the job records the group too, for the processes a forked builtin starts itself
+        int pgid = job->pgid ? job->pgid : getpid();
+        setpgid(0, pgid);
+        job->pgid = pgid;
+        if (job->foreground)
+            giveTerminalTo(pgid);
+    }
+
+    // undo what the shell ignores or catches for itself
+    sigset_t signals;
+    getJobSignals(&signals);
+    for (int signal = 1; signal < NSIG; signal++)
+    {
+        if (sigismember(&signals, signal) == 1)
+            sigaction(signal, &(struct sigaction){.sa_handler = SIG_DFL}, NULL);
+    }
+}
+
+bool isJobInOwnGroup(Job* job)
+{
+    // without job control, a job only leaves the shell's group when it's given a group of its own (pgid 0), like the command of timeout
+    return interactiveShell || job->pgid != shellPgid;
+}
+
+int getJobTerminal(Job* job)
+{
+    return job->foreground ? terminalFD : -1;
+}
+
+void getJobSignals(sigset_t* signals)
+{
+    sigemptyset(signals);
+    sigaddset(signals, SIGINT);
+    sigaddset(signals, SIGQUIT);
+    sigaddset(signals, SIGTSTP);
+    sigaddset(signals, SIGTTIN);
+    sigaddset(signals, SIGTTOU);
+    sigaddset(signals, SIGCHLD);
+}
+
+void reportBackgroundJob(Job* job)
+{
+    if (interactiveShell)
+    {
+        printf("[%d] %d\n", job->id, job->pgid);
+        fflush(stdout);
+    }
+}
+
+void removeJob(Job* job)
+{
+    if (!job)
+        return;
+
+    // unlink the job from the table
+    Job* prev = NULL;
+    for (Job* curr = jobsHead; curr; prev = curr, curr = curr->next)
+    {
+        if (curr != job)
+            continue;
+
+        if (prev)
+            prev->next = curr->next;
+        else
+            jobsHead = curr->next;
+
+        if (jobsTail == curr)
+            jobsTail = prev;
+        break;
+    }
+
+    free(job->processes);
+    free(job->commandLine);
+    free(job);
+}
+
+/*-------------------------------Waiting-------------------------------------------------*/
+
+JobState getJobState(Job* job)
+{
+    bool stopped = false;
+    for (int i = 0; i < job->nProcesses; i++)
+    {
+        if (job->processes[i].state == JOB_RUNNING)
+            return JOB_RUNNING;
+        if (job->processes[i].state == JOB_STOPPED)
+            stopped = true;
+    }
+    return stopped ? JOB_STOPPED : JOB_DONE;
+}
+
+int waitForJob(Job* job)
+{
+    int result = awaitJobs(&job, 1, -1);
+
+    if (job->foreground)
+        giveTerminalTo(shellPgid);
+
+    if (result > 1)
+        return result;
+
+    // a stopped job reports the signal that stopped it, e.g. 147 for SIGSTOP. its stopped processes have that as their status
+    if (getJobState(job) == JOB_STOPPED)
+    {
+        for (int i = job->nProcesses - 1; i >= 0; i--)
+        {
+            if (job->processes[i].state == JOB_STOPPED)
+                return job->processes[i].status;
+        }
+    }
+
+    return job->processes[job->nProcesses - 1].status;
+}
+
+void reapJobs(void)
+{
+    if (!childStatusChanged)
+        return;
+    childStatusChanged = 0;
+
+    for (Job* job = jobsHead; job; job = job->next)
+    {
+        if (!job->pgid || getJobState(job) == JOB_DONE)
+            continue;
+
+        int status;
+        int pid;
+        while ((pid = waitpid(-job->pgid, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0)
+            markProcessStatus(pid, status);
+    }
+}
+
+void notifyJobs(void)
+{
+    reapJobs();
+
+    Job* job = jobsHead;
+    while (job)
+    {
+        Job* next = job->next;
+        JobState state = getJobState(job);
+
+        if (state == JOB_DONE)
+        {
+            // in a script, finished jobs are kept until `wait` or `jobs` has seen them
+            if (!interactiveShell && !job->notified)
+            {
+                job = next;
+                continue;
+            }
+
+            if (!job->notified)
+                printf("[%d]%c  %-24s%s\n", job->id, getJobMarker(job), "Done", job->commandLine);
+            removeJob(job);
+        }
+        else if (state == JOB_STOPPED && !job->notified)
+        {
+            if (interactiveShell)
+                printf("[%d]%c  %-24s%s\n", job->id, getJobMarker(job), "Stopped", job->commandLine);
+            job->notified = true;
+        }
+
+        job = next;
+    }
+    fflush(stdout);
+}
+
+/*-------------------------------Lookup--------------------------------------------------*/
+
+Job* getJobs(void)
+{
+    return jobsHead;
+}
+
+// the current job ('+') is the most recent job with processes. jobs without processes are pipelines of builtins that are running right now in the shell itself
+static Job* getCurrentJob(Job** previous)
+{
+    Job* current = NULL;
+    Job* before = NULL;
+    for (Job* job = jobsHead; job; job = job->next)
+    {
+        if (job->nProcesses == 0)
+            continue;
+        before = current;
+        current = job;
+    }
+
+    if (previous)
+        *previous = before;
+    return current;
+}
+
+char getJobMarker(Job* job)
+{
+    Job* previous = NULL;
+    Job* current = getCurrentJob(&previous);
+
+    if (job == current)
+        return '+';
+    if (job == previous)
+        return '-';
+    return ' ';
+}
+
+Job* findJob(const char* spec)
+{
+    Job* previous = NULL;
+    Job* current = getCurrentJob(&previous);
+
+    if (!spec || strcmp(spec, "%%") == 0 || strcmp(spec, "%+") == 0 || strcmp(spec, "%") == 0)
+        return current;
+
+    if (strcmp(spec, "%-") == 0)
+        return previous;
+
+    if (spec[0] == '%')
+    {
+        int id = atoi(spec + 1);
+        for (Job* job = jobsHead; job; job = job->next)
+        {
+            if (job->id == id && job->nProcesses > 0)
+                return job;
+        }
+        return NULL;
+    }
+
+    // a pid of one of the job's processes
+    Process* process = findProcess(atoi(spec));
+    if (!process)
+        return NULL;
+
+    for (Job* job = jobsHead; job; job = job->next)
+    {
+        if (process >= job->processes && process < job->processes + job->nProcesses)
+            return job;
+    }
+
+    return NULL;
+}
+
+int continueJob(Job* job, bool foreground)
+{
+    for (int i = 0; i < job->nProcesses; i++)
+    {
+        if (job->processes[i].state == JOB_STOPPED)
+            job->processes[i].state = JOB_RUNNING;
+    }
+    job->foreground = foreground;
+    job->notified = false;
+
+    if (foreground)
+        giveTerminalTo(job->pgid);
+
+    if (signalJob(job, SIGCONT) == -1)
+    {
+        LOG_ERROR("kill: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file lexer.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the lexer declared in lexer.h
+ * @version 0.1
+ * @date 2023-07-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "lexer.h"
+#include "variables.h"
+
+// characters that end an unquoted word
+#define IS_BLANK(c) ((c) == ' ' || (c) == '\t')
+#define IS_OPERATOR_START(c) ((c) == '|' || (c) == '&' || (c) == ';' || (c) == '<' || (c) == '>' || (c) == '\n')
+
+// writes a quoted character of a word, escaped if it would be special to pathname expansion
+static char* writeQuoted(char* out, char c)
+{
+    if (strchr(QUOTED_ESCAPES, c))
+        *out++ = '\\';
+    *out++ = c;
+    return out;
+}
+
+// makes sure the list's allocation can hold the tokens of a line of the given length
+static int reserveTokenList(TokenList* list, size_t length)
+{
+    // worst case, every character is a token of its own, and every token adds a NUL to the arena. a quoted character takes at most two bytes with its escape, and its quotes make up for the escape
+    size_t maxTokens = length + 1;
+    size_t needed = maxTokens * sizeof(Token) + 2 * length + 1;
+
+    if (needed > list->capacity)
+    {
+        Token* block = (Token*)realloc(list->tokens, needed);
+        if (!block)
+        {
+            LOG_DEBUG("Realloc error. Failed to reallocate memory for the token list.\n");
+            return -1;
+        }
+        list->tokens = block;
+        list->capacity = needed;
+    }
+
+    list->arena = (char*)(list->tokens + maxTokens);
+    list->count = 0;
+    return 0;
+}
+
+// reads an operator at input, returns its length
+static size_t lexOperator(const char* input, Token* token)
+{
+    switch (input[0])
+    {
+    case '|':
+        token->type = input[1] == '|' ? TOKEN_OR : TOKEN_PIPE;
+        break;
+    case '&':
+        token->type = input[1] == '&' ? TOKEN_AND : TOKEN_BACKGROUND;
+        break;
+    case '>':
+        token->type = input[1] == '>' ? TOKEN_REDIR_APPEND : TOKEN_REDIR_OUT;
+        break;
+    case '<':
+        token->type = TOKEN_REDIR_IN;
+        return 1;
+    default:
+        // ';' and newline
+        token->type = TOKEN_SEMICOLON;
+        return 1;
+    }
+
+    return token->type == TOKEN_OR || token->type == TOKEN_AND || token->type == TOKEN_REDIR_APPEND ? 2 : 1;
+}
+
+int tokenize(const char* input, TokenList* list)
+{
+    list->error = NULL;
+    if (reserveTokenList(list, strlen(input)))
+    {
+        list->error = "Out of memory";
+        return -1;
+    }
+
+    const char* p = input;
+    char* out = list->arena;
+
+    while (*p)
+    {
+        if (IS_BLANK(*p))
+        {
+            p++;
+            continue;
+        }
+
+        // a comment runs until the end of the line
+        if (*p == '#')
+            break;
+
+        Token* token = &list->tokens[list->count++];
+        token->flags = 0;
+        token->offset = out - list->arena;
+
+        if (IS_OPERATOR_START(*p))
+        {
+            size_t length = lexOperator(p, token);
+            // newlines are stored as ';', they mean the same
+            if (*p == '\n')
+                *out++ = ';';
+            else
+                out = (char*)memcpy(out, p, length) + length;
+            p += length;
+        }
+        else
+        {
+            token->type = TOKEN_WORD;
+
+            // where the first quoted or escaped character of the word went, an assignment's name and '=' must come before it
+            char* firstQuoted = NULL;
+            // the number of `${` the word is inside of. blanks and operators in them are part of the word, like in `${x:-a b}`
+            int braces = 0;
+
+            // the word is copied into the arena with its quotes and escapes removed
+            while (*p && (braces || (!IS_BLANK(*p) && !IS_OPERATOR_START(*p))))
+            {
+                if (*p == '\'')
+                {
+                    // everything up to the closing quote is literal
+                    token->flags |= TOKEN_QUOTED;
+                    if (!firstQuoted)
+                        firstQuoted = out;
+                    for (p++; *p && *p != '\''; p++)
+                        out = writeQuoted(out, *p);
+
+                    if (!*p)
+                    {
+                        list->error = "Unterminated quoted string";
+                        return -1;
+                    }
+                    p++;
+                }
+                else if (*p == '"')
+                {
+                    // inside double quotes a backslash only escapes the characters that are special there
+                    token->flags |= TOKEN_QUOTED;
+                    if (!firstQuoted)
+                        firstQuoted = out;
+                    for (p++; *p && *p != '"'; p++)
+                    {
+                        if (*p == '\\' && p[1] && strchr("\"\\$`", p[1]))
+                        {
+                            out = writeQuoted(out, *++p);
+                        }
+                        else if (*p == '$')
+                        {
+                            token->flags |= TOKEN_EXPAND;
+                            *out++ = EXPAND_QUOTED;
+                            // the '$' of `$$` is the name of the parameter
+                            if (p[1] == '$')
+                                *out++ = *++p;
+                        }
+                        else
+                        {
+                            out = writeQuoted(out, *p);
+                        }
+                    }
+
+                    if (!*p)
+                    {
+                        list->error = "Unterminated quoted string";
+                        return -1;
+                    }
+                    p++;
+                }
+                else if (*p == '\\')
+                {
+                    // an unquoted backslash makes the next character literal. a backslash-newline is a line continuation, and is dropped
+                    token->flags |= TOKEN_QUOTED;
+                    if (!firstQuoted)
+                        firstQuoted = out;
+                    p++;
+                    if (*p && *p != '\n')
+                        out = writeQuoted(out, *p);
+                    if (*p)
+                        p++;
+                }
+                else if (*p == '$')
+                {
+                    token->flags |= TOKEN_EXPAND;
+                    *out++ = EXPAND_UNQUOTED;
+                    p++;
+                    if (*p == '$')
+                        *out++ = *p++;
+                    else if (*p == '{')
+                        braces++;
+                }
+                else
+                {
+                    if (*p == '}' && braces)
+                        braces--;
+                    *out++ = *p++;
+                }
+            }
+
+            *out = '\0';
+            char* text = list->arena + token->offset;
+            size_t nameLength = variableNameLength(text);
+            if (nameLength > 0 && text[nameLength] == '=' && (!firstQuoted || firstQuoted > text + nameLength))
+                token->flags |= TOKEN_ASSIGNMENT;
+        }
+
+        token->length = out - (list->arena + token->offset);
+        *out++ = '\0';
+    }
+
+    return 0;
+}
+
+void freeTokenList(TokenList* list)
+{
+    free(list->tokens);
+    list->tokens = NULL;
+    list->arena = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
@@ -12,40 +12,62 @@
 #include "utils.h"
 #include "command.h"
 #include "parser.h"
+#include "lexer.h"
 #include "hashtable.h"
 #include "shell_builtins.h"
+#include "jobs.h"
+#include "script_cache.h"
+#include "variables.h"
+#include "wildcard.h"
+#include "walk.h"
+#include "input.h"
+#include "spawn_server.h"
 
 #include <errno.h>
 #include <readline/readline.h>
 #include <readline/history.h>
 
-// Number of buckets used by the alias hashtable.
-#define NUMBER_OF_BUCKETS 101
-
-/* The shell supports three different modes:
- * 1. Interactive: The default usage. An interactive command line.
- * 2. Non_interactive: When the input is not via a terminal but by any other mean.
- * 3. Script: Runs a list of commands specified in a file.
- */
-#define INTERACTIVE_MODE 1
-#define NON_INTERACTIVE_MODE 2
-#define SCRIPT_MODE 3
-
 // Global variables
-int lastExitStatus = 0;
 hashtable *aliases = NULL;
 
+// the script being run in script mode. it is read line by line as the commands are executed, so the script is never held in memory as a whole
 FILE *script = NULL;
-// array to store individual lines of input from the script
-char **inputCommands = NULL;
 
-int mode = 0;
+// the compiled form of the script, which the lines are read from instead of the script when it is available
+FILE *scriptCache = NULL;
 
-int originalStdoutFD = STDOUT_FD;
-int originalStdinFD = STDIN_FD;
+// offset in the script of the line after the last one read from its compiled form, where the script is read from if the rest of the cache can't be
+static long scriptCacheOffset = 0;
+
+// what's left of the -c string in command mode. it is run a line at a time, like a script
+const char *commandString = NULL;
+
+int mode = 0;
 
 // Useful functions
-char *getInput(void);
+
+/**
+ * @brief Reads the next line of input, according to the mode the shell is running in.
+ *
+ * @param arena The arena of the line, compiled lines are read into it
+ * @param compiled Set to the line's command chain if the line was read from a compiled script, or compiled as it was read, NULL otherwise
+ * @return char* The line, without the trailing newline, or NULL on EOF. It is owned by getInput (or allocated from the arena) and stays valid until the next call.
+ */
+char *getInput(Arena *arena, CommandChain **compiled);
+
+/**
+ * @brief Checks if the line getInput returned last is the last line of the input, so that the last command of the line is the last thing the shell runs.
+ *
+ * @return true if there's no line after it
+ */
+bool isLastLine(void);
+
+/**
+ * @brief Stops reading the compiled script, once it has no more lines or can't be read, and goes on with the script itself from the line the cache stopped at.
+ *
+ * @return int Status code (0 on success, -1 if the script can't be read from there)
+ */
+static int leaveScriptCache(void);
 
 /**
  * @brief This is the main function for the shell. It contains the main loop that runs the shell.
@@ -54,53 +76,41 @@ char *getInput(void);
  */
 int main(int argc, char **argv)
 {
-    if (argc > 2)
+    // the spawn server is forked before the shell builds any of its state, so that it stays as small as the shell ever is
+    if (getenv("SHELL_SPAWN_SERVER") && startSpawnServer())
+        LOG_DEBUG("Failed to start the spawn server, processes are spawned by the shell\n");
+
+    // sh -c string [name [args...]]. the shell has no positional parameters, so whatever comes after the string is ignored
+    if (argc >= 2 && strcmp(argv[1], "-c") == 0)
     {
-        LOG_ERROR("Usage: %s [script]\n", argv[0]);
+        if (argc == 2)
+        {
+            LOG_ERROR("%s: -c requires an argument\n", argv[0]);
+            exit(2);
+        }
+        mode = COMMAND_MODE;
+        commandString = argv[2];
+    }
+    else if (argc > 2)
+    {
+        LOG_ERROR("Usage: %s [script | -c command]\n", argv[0]);
         exit(1);
     }
-
     // If a script is provided, run it and exit
-    if (argc == 2)
+    else if (argc == 2)
     {
         mode = SCRIPT_MODE;
-        script = fopen(argv[1], "r");
+        // opened close-on-exec, so that the commands run by the script don't inherit it
+        script = fopen(argv[1], "re");
         if (!script)
         {
             LOG_ERROR("Error opening script %s: %s\n", argv[1], strerror(errno));
             exit(1);
         }
 
-        inputCommands = malloc(sizeof(char *) * MAX_STRING_LENGTH);
-        if (!inputCommands)
-        {
-            LOG_ERROR("Error allocating memory for inputCommands: %s\n", strerror(errno));
-            exit(1);
-        }
-
-        int i = 0;
-        while (1)
-        {
-            inputCommands[i] = malloc(sizeof(char) * MAX_STRING_LENGTH);
-            if (!inputCommands[i])
-            {
-                LOG_ERROR("Error allocating memory for inputCommands[%d]: %s\n", i, strerror(errno));
-                exit(1);
-            }
-
-            if (fgets(inputCommands[i], MAX_STRING_LENGTH, script) == NULL)
-            {
-                free(inputCommands[i]);
-                inputCommands[i] = NULL;
-                break;
-            }
-
-            // Remove trailing newline
-            if (inputCommands[i][strlen(inputCommands[i]) - 1] == '\n')
-                inputCommands[i][strlen(inputCommands[i]) - 1] = '\0';
-
-            i++;
-        }
+        // the lines are lexed and parsed once, and read back already parsed on later runs of the same script. the cache is written next to the script, so it is only used when asked for
+        if (getenv("SHELL_SCRIPT_CACHE"))
+            scriptCache = openScriptCache(argv[1], script);
     }
     else
     {
@@ -117,17 +127,24 @@ int main(int argc, char **argv)
         else
         {
             mode = NON_INTERACTIVE_MODE;
+            initInput(STDIN_FD);
         }
     }
 
     // Initialize aliases hashtable
-    aliases = createHashtable(NUMBER_OF_BUCKETS);
+    aliases = createHashtable(HASHTABLE_INITIAL_CAPACITY);
     if (!aliases)
     {
         LOG_DEBUG("Error creating hashtable for aliases\n");
         exit(1);
     }
 
+    // the shell's variables, starting with the environment it was run with
+    initVariables();
+
+    // process groups, terminal ownership and SIGCHLD handling for jobs
+    initJobControl(mode == INTERACTIVE_MODE);
+
     LOG_DEBUG("Starting shell\n");
     LOG_DEBUG("Shell's state:\n");
     if (mode == INTERACTIVE_MODE)
@@ -139,26 +156,36 @@ int main(int argc, char **argv)
     }
     else if (mode == NON_INTERACTIVE_MODE)
         LOG_DEBUG("-- Running in NON_INTERACTIVE_MODE mode.\n");
+    else if (mode == COMMAND_MODE)
+        LOG_DEBUG("-- Running in COMMAND mode.\n");
+
+    // the tokens of the current line. the list's memory is reused from line to line
+    TokenList tokens = {NULL, 0, NULL, 0, NULL};
 
-    // assuming all tokens are separated by atleast one space
-    char delimiter = ' ';
+    // everything a line is parsed into is allocated from this arena, and freed at once before the next line is read
+    Arena lineArena;
+    initArena(&lineArena, ARENA_BLOCK_SIZE);
 
     while (1)
     {
+        // free everything built for the previous line
+        resetArena(&lineArena);
+
+        // collect background jobs that finished or stopped, and tell the user about them before the next prompt
+        notifyJobs();
+
         // read input
-        char *input = getInput();
+        CommandChain *commandChain = NULL;
+        char *input = getInput(&lineArena, &commandChain);
         // Check for EOF.
         if (!input)
             break;
         if (strcmp(input, "") == 0)
-        {
-            free(input);
             continue;
-        }
         if (strcmp(input, "exit") == 0)
         {
-            printf("Exiting shell\n");
-            free(input);
+            if (mode == INTERACTIVE_MODE)
+                printf("Exiting shell\n");
             break;
         }
 
@@ -166,90 +193,179 @@ int main(int argc, char **argv)
         if (mode == INTERACTIVE_MODE)
             add_history(input);
 
-        // simple whitespace tokenizer
-        char **tokens = tokenizeString(input, delimiter);
-
-        for (int i = 0; tokens[i] != NULL; i++)
+        // lines of a compiled script come already parsed
+        if (!commandChain)
         {
-            LOG_DEBUG("Token %d: [%s]\n", i, tokens[i]);
-        }
+            // split the line into words and operators
+            if (tokenize(input, &tokens))
+            {
+                LOG_ERROR("Syntax error: %s\n", tokens.error);
+                continue;
+            }
 
-        // generate the command from tokens
-        CommandChain *commandChain = parseTokens(tokens);
+            for (int i = 0; i < tokens.count; i++)
+            {
+                LOG_DEBUG("Token %d: [%s]\n", i, TOKEN_TEXT(&tokens, i));
+            }
+
+            // generate the command from tokens
+            commandChain = parseTokens(&tokens, &lineArena);
+        }
 
         // display the command chain
         printCommandChain(commandChain);
 
-        // execute the command
-        int status = executeCommandChain(commandChain);
+        // execute the command. the args the words expand to are allocated from the line's arena as well. the last command of the input may replace the shell, in which case this doesn't return
+        int status = executeCommandChain(commandChain, &lineArena, isLastLine());
         LOG_DEBUG("Command executed with status %d\n", status);
-
-        // Free tokens
-        freeTokens(tokens);
-
-        // free the command chain
-        cleanUpCommandChain(commandChain);
-
-        // Free buffer that was allocated by readline
-        free(input);
     }
 
-    if (mode == SCRIPT_MODE)
-    {
-        free(inputCommands);
-        if (script)
-            fclose(script);
-    }
+    finishScriptCache();
+    if (script)
+        fclose(script);
+    if (scriptCache)
+        fclose(scriptCache);
+
+    freeTokenList(&tokens);
+    destroyArena(&lineArena);
 
     deleteHashtable(aliases);
-    return 0;
+    cleanUpJobs();
+    clearCommandCache();
+    clearDirectoryCache();
+    stopWalkThreads();
+    freeVariables();
+    freeInput();
+    stopSpawnServer();
+    return getLastStatus();
 }
 
-char *getInput()
+char *getInput(Arena *arena, CommandChain **compiled)
 {
-    static int currentCommand = 0;
-    static char prompt_buffer[MAX_STRING_LENGTH];
+    // the line returned by the last call. lines read from a stream share one buffer that is reused, readline allocates a new line every time
+    static LineBuffer lineBuffer = {NULL, 0};
+    static char *readlineInput = NULL;
 
-    char *input = NULL;
-    char *cwd_res = getcwd(prompt_buffer, MAX_STRING_LENGTH);
+    free(readlineInput);
+    readlineInput = NULL;
 
+    FILE *stream = NULL;
     switch (mode)
     {
     case INTERACTIVE_MODE:
-        if (!cwd_res)
+    {
+        char *cwd = getcwd(NULL, 0);
+        if (!cwd)
         {
             LOG_ERROR("Error getting current working directory: %s\n", strerror(errno));
             exit(1);
         }
 
-        input = readline(strcat(prompt_buffer, " $ "));
-        break;
-    case NON_INTERACTIVE_MODE:
-        input = malloc(sizeof(char) * MAX_STRING_LENGTH);
-        if (!input)
+        char *prompt = malloc(strlen(cwd) + sizeof(" $ "));
+        if (!prompt)
+        {
+            LOG_ERROR("Error allocating memory for prompt: %s\n", strerror(errno));
+            exit(1);
+        }
+        strcat(strcpy(prompt, cwd), " $ ");
+        free(cwd);
+
+        readlineInput = readline(prompt);
+        free(prompt);
+        return readlineInput;
+    }
+    case COMMAND_MODE:
+    {
+        if (!*commandString)
+            return NULL;
+
+        size_t length = strcspn(commandString, "\n");
+        char *line = (char *)arenaAlloc(arena, length + 1);
+        if (!line)
         {
-            LOG_ERROR("Error allocating memory for input: %s\n", strerror(errno));
+            LOG_ERROR("Error allocating memory for the command\n");
             exit(1);
         }
-        if (fgets(input, MAX_STRING_LENGTH, stdin) == NULL)
+        memcpy(line, commandString, length);
+        line[length] = '\0';
+
+        commandString += length + (commandString[length] == '\n');
+        return line;
+    }
+    case NON_INTERACTIVE_MODE:
+        // stdin is shared with the commands, which read from it too, so it isn't read through stdio
+        if (readInputLine(&lineBuffer) == -1)
         {
-            free(input);
+            freeLineBuffer(&lineBuffer);
             return NULL;
         }
-        // Remove trailing newline
-        if (input[strlen(input) - 1] == '\n')
-            input[strlen(input) - 1] = '\0';
-        break;
+        return lineBuffer.data;
     case SCRIPT_MODE:
-        if (inputCommands[currentCommand] == NULL)
-            return NULL;
-        input = inputCommands[currentCommand];
-        currentCommand++;
+        if (scriptCache)
+        {
+            char *line;
+            if (readCompiledLine(scriptCache, arena, &line, compiled, &scriptCacheOffset) == 0)
+                return line;
+            if (leaveScriptCache())
+                return NULL;
+        }
+
+        // the next line is read from the (buffered) script only when it is about to be executed
+        stream = script;
         break;
     default:
         LOG_ERROR("Invalid mode %d\n", mode);
         exit(1);
     }
 
-    return input;
-}
\ No newline at end of file
+    if (readLine(stream, &lineBuffer) == -1)
+    {
+        freeLineBuffer(&lineBuffer);
+        return NULL;
+    }
+
+    // without a cache, the script is compiled into one as it is read
+    *compiled = compileScriptLine(lineBuffer.data, arena);
+    return lineBuffer.data;
+}
+
+bool isLastLine(void)
+{
+    switch (mode)
+    {
+    case COMMAND_MODE:
+        return *commandString == '\0';
+    case SCRIPT_MODE:
+    {
+        // only the shell reads the script (or its compiled form), so it can look ahead of the line
+        FILE *stream = scriptCache ? scriptCache : script;
+        int c = getc(stream);
+        // a cache that ends early doesn't mean the script does
+        if (c == EOF && scriptCache && leaveScriptCache() == 0)
+        {
+            stream = script;
+            c = getc(stream);
+        }
+        if (c == EOF)
+            return true;
+        ungetc(c, stream);
+        return false;
+    }
+    default:
+        // stdin can't be looked ahead of without taking input from the commands, and an interactive shell never knows
+        return false;
+    }
+}
+
+static int leaveScriptCache(void)
+{
+    fclose(scriptCache);
+    scriptCache = NULL;
+
+    if (fseek(script, scriptCacheOffset, SEEK_SET) == -1)
+    {
+        LOG_ERROR("Error reading the script: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file output.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the output sink declared in output.h
+ * @version 0.1
+ * @date 2023-07-22
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "output.h"
+
+#include <errno.h>
+#include <sys/uio.h>
+
+// writes all of the given vectors, retrying on partial writes and interrupts
+static int writeAll(OutputSink* sink, struct iovec* iov, int count)
+{
+    // the shell's own messages go through stdio, and have to come out before output that was produced after them
+    fflush(stdout);
+
+    while (count > 0)
+    {
+        ssize_t written = writev(sink->fd, iov, count);
+        if (written == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            sink->error = errno;
+            return -1;
+        }
+
+        // skip the vectors that were written completely, and advance into the one that was written partially
+        while (count > 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return 0;
+}
+
+void initOutputSink(OutputSink* sink, int fd)
+{
+    fflush(stdout);
+    sink->fd = fd;
+    sink->error = 0;
+    sink->length = 0;
+}
+
+int sinkWrite(OutputSink* sink, const char* data, size_t length)
+{
+    if (sink->error)
+        return -1;
+
+    if (length <= OUTPUT_BUFFER_SIZE - sink->length)
+    {
+        memcpy(sink->buffer + sink->length, data, length);
+        sink->length += length;
+        return 0;
+    }
+
+    // the data doesn't fit, so it goes out along with the buffer in a single writev
+    struct iovec iov[2] = {
+        {sink->buffer, sink->length},
+        {(void*)data, length}
+    };
+    sink->length = 0;
+
+    return writeAll(sink, iov, 2);
+}
+
+int sinkPuts(OutputSink* sink, const char* str)
+{
+    return sinkWrite(sink, str, strlen(str));
+}
+
+int sinkPrintf(OutputSink* sink, const char* format, ...)
+{
+    if (sink->error)
+        return -1;
+
+    // format straight into the buffer when the output fits
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(sink->buffer + sink->length, OUTPUT_BUFFER_SIZE - sink->length, format, args);
+    va_end(args);
+
+    if (length < 0)
+        return -1;
+
+    if ((size_t)length < OUTPUT_BUFFER_SIZE - sink->length)
+    {
+        sink->length += length;
+        return 0;
+    }
+
+    // too long for what's left of the buffer, format it separately
+    char* formatted = (char*)malloc(length + 1);
+    if (!formatted)
+    {
+        LOG_DEBUG("Failed to allocate memory for formatted output\n");
+        return -1;
+    }
+
+    va_start(args, format);
+    vsnprintf(formatted, length + 1, format, args);
+    va_end(args);
+
+    int status = sinkWrite(sink, formatted, length);
+    free(formatted);
+
+    return status;
+}
+
+int sinkFlush(OutputSink* sink)
+{
+    if (sink->error)
+        return -1;
+
+    if (sink->length == 0)
+        return 0;
+
+    struct iovec iov = {sink->buffer, sink->length};
+    sink->length = 0;
+
+    return writeAll(sink, &iov, 1);
+}
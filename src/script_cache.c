@@ -0,0 +1,461 @@
+/**
+ * @file script_cache.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the compiled script cache declared in script_cache.h
+ *
+ * The cache file is a header, followed by one record per line of the script:
+ * - the text of the line
+ * - whether the line was parsed, and if so its command chain: for every command its background flag, chaining operator and simple commands, and for every simple command its words (with their flags) and redirections
+ * - the offset in the script of the line after it, where the script is read from if the rest of the cache can't be
+ *
+ * Strings are stored as a length followed by the bytes, numbers in the machine's byte order. The cache is only ever read by the machine that wrote it.
+ * @version 0.1
+ * @date 2023-07-24
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#define _GNU_SOURCE  // for O_TMPFILE
+
+#include "script_cache.h"
+#include "lexer.h"
+#include "parser.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <libgen.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// length stored for a NULL string
+#define NO_STRING UINT32_MAX
+
+/**
+ * @brief The header of a cache file. It identifies the version of the script the cache was compiled from.
+ *
+ */
+typedef struct ScriptCacheHeader
+{
+    char magic[4];              //< "SHC"
+    uint32_t version;           //< SCRIPT_CACHE_VERSION
+    uint64_t device;            //< the script's device
+    uint64_t inode;             //< the script's inode
+    int64_t size;               //< the script's size
+    int64_t mtimeSeconds;       //< the script's modification time
+    int64_t mtimeNanoseconds;
+} ScriptCacheHeader;
+
+// fills in the header a cache of the script has to have
+static void makeHeader(ScriptCacheHeader* header, const struct stat* scriptStat)
+{
+    memset(header, 0, sizeof(ScriptCacheHeader));
+    memcpy(header->magic, "SHC", 4);
+    header->version = SCRIPT_CACHE_VERSION;
+    header->device = scriptStat->st_dev;
+    header->inode = scriptStat->st_ino;
+    header->size = scriptStat->st_size;
+    header->mtimeSeconds = scriptStat->st_mtim.tv_sec;
+    header->mtimeNanoseconds = scriptStat->st_mtim.tv_nsec;
+}
+
+// the path of the cache of a script: .<name>.shc in the script's directory
+static char* getCachePath(const char* scriptPath)
+{
+    char* directoryCopy = strdup(scriptPath);
+    char* nameCopy = strdup(scriptPath);
+    char* cachePath = NULL;
+
+    if (directoryCopy && nameCopy)
+    {
+        const char* directory = dirname(directoryCopy);
+        const char* name = basename(nameCopy);
+
+        size_t length = strlen(directory) + strlen(name) + sizeof("/..shc");
+        cachePath = (char*)malloc(length);
+        if (cachePath)
+            snprintf(cachePath, length, "%s/.%s.shc", directory, name);
+    }
+
+    free(directoryCopy);
+    free(nameCopy);
+    return cachePath;
+}
+
+/*-------------------------------Writing--------------------------------------------------*/
+
+// write errors are checked once, with ferror, after the whole script has been written
+
+static void writeNumber(FILE* cache, uint32_t number)
+{
+    fwrite(&number, sizeof(number), 1, cache);
+}
+
+static void writeOffset(FILE* cache, uint64_t offset)
+{
+    fwrite(&offset, sizeof(offset), 1, cache);
+}
+
+static void writeString(FILE* cache, const char* str)
+{
+    if (!str)
+    {
+        writeNumber(cache, NO_STRING);
+        return;
+    }
+
+    uint32_t length = strlen(str);
+    writeNumber(cache, length);
+    fwrite(str, 1, length, cache);
+}
+
+static void writeChain(FILE* cache, CommandChain* chain)
+{
+    uint32_t nCommands = 0;
+    for (Command* command = chain->head; command; command = command->next)
+        nCommands++;
+
+    writeNumber(cache, nCommands);
+    for (Command* command = chain->head; command; command = command->next)
+    {
+        writeNumber(cache, command->background);
+        writeNumber(cache, command->chainingOperator);
+        writeNumber(cache, command->nSimpleCommands);
+
+        for (int i = 0; i < command->nSimpleCommands; i++)
+        {
+            SimpleCommand* simpleCommand = command->simpleCommands[i];
+
+            writeNumber(cache, simpleCommand->nWords);
+            for (int j = 0; j < simpleCommand->nWords; j++)
+            {
+                writeNumber(cache, simpleCommand->words[j].flags);
+                writeString(cache, simpleCommand->words[j].text);
+            }
+
+            writeString(cache, simpleCommand->inputFile);
+            writeString(cache, simpleCommand->outputFile);
+            writeNumber(cache, simpleCommand->append);
+        }
+    }
+}
+
+// the compiled form of the script being run, while it is written. on a cache miss, every line is compiled and written as the shell reads it, so the script's commands start right away. the file is anonymous (O_TMPFILE) until the whole script is in it, so a shell that exits or execs early leaves nothing behind
+typedef struct ScriptCompiler
+{
+    FILE* cache;                //< the cache being written, NULL if no script is being compiled
+    FILE* script;
+    char* cachePath;
+    ScriptCacheHeader header;
+    pid_t owner;                //< the shell, not a forked builtin with a copy of the compiler
+    TokenList tokens;
+} ScriptCompiler;
+
+static ScriptCompiler compiler;
+
+// lexes and parses a line, and writes its record to the cache. returns the line's command chain, NULL if it doesn't lex or parse
+static CommandChain* compileLine(const char* line, Arena* arena)
+{
+    // a line that doesn't lex or parse is stored as text only. it is lexed and parsed again when it is run, which reports the error at the right time
+    CommandChain* chain = NULL;
+    if (tokenize(line, &compiler.tokens) == 0)
+        chain = parseTokens(&compiler.tokens, arena);
+
+    writeString(compiler.cache, line);
+    writeNumber(compiler.cache, chain != NULL);
+    if (chain)
+        writeChain(compiler.cache, chain);
+    // the line was just read from the script, which is right after it
+    writeOffset(compiler.cache, ftell(compiler.script));
+
+    return chain;
+}
+
+static void closeCompiler(void)
+{
+    fclose(compiler.cache);
+    free(compiler.cachePath);
+    freeTokenList(&compiler.tokens);
+    compiler.cache = NULL;
+    compiler.cachePath = NULL;
+}
+
+// opens an anonymous file in the script's directory, which the script is compiled into
+static int openCompiler(const char* cachePath, FILE* script, const ScriptCacheHeader* header)
+{
+    char* directoryCopy = strdup(cachePath);
+    int fd = directoryCopy ? open(dirname(directoryCopy), O_TMPFILE | O_WRONLY | O_CLOEXEC, 0600) : -1;
+    free(directoryCopy);
+
+    FILE* cache = fd != -1 ? fdopen(fd, "w") : NULL;
+    char* path = cache ? strdup(cachePath) : NULL;
+    if (!path)
+    {
+        LOG_DEBUG("Can't create a compiled script at %s: %s\n", cachePath, strerror(errno));
+        if (cache)
+            fclose(cache);
+        else if (fd != -1)
+            close(fd);
+        return -1;
+    }
+
+    compiler.cache = cache;
+    compiler.script = script;
+    compiler.cachePath = path;
+    compiler.header = *header;
+    compiler.owner = getpid();
+    fwrite(header, sizeof(*header), 1, cache);
+    return 0;
+}
+
+CommandChain* compileScriptLine(const char* line, Arena* arena)
+{
+    if (!compiler.cache || compiler.owner != getpid())
+        return NULL;
+
+    return compileLine(line, arena);
+}
+
+void finishScriptCache(void)
+{
+    if (!compiler.cache || compiler.owner != getpid())
+        return;
+
+    // whatever the shell didn't get to run is compiled as well. the script is read from where the shell is, and put back there, in case the shell goes on
+    long position = ftell(compiler.script);
+    int status = position == -1 ? -1 : 0;
+    if (status == 0)
+    {
+        LineBuffer line = {NULL, 0};
+        Arena arena;
+        initArena(&arena, ARENA_BLOCK_SIZE);
+
+        while (readLine(compiler.script, &line) != -1)
+        {
+            compileLine(line.data, &arena);
+            resetArena(&arena);
+        }
+        if (ferror(compiler.script) || fseek(compiler.script, position, SEEK_SET) == -1)
+            status = -1;
+
+        freeLineBuffer(&line);
+        destroyArena(&arena);
+    }
+
+    // if the script was changed while it was compiled, the cache may be a mix of both versions
+    struct stat afterStat;
+    ScriptCacheHeader after;
+    if (status == 0 && fstat(fileno(compiler.script), &afterStat) == 0)
+    {
+        makeHeader(&after, &afterStat);
+        if (memcmp(&after, &compiler.header, sizeof(after)) != 0)
+            status = -1;
+    }
+
+    // the file gets a temporary name first, which then replaces the cache, so that a concurrent run of the script never reads a partial cache
+    char procPath[64];
+    snprintf(procPath, sizeof(procPath), "/proc/self/fd/%d", fileno(compiler.cache));
+    size_t length = strlen(compiler.cachePath) + 32;
+    char* temporaryPath = (char*)malloc(length);
+    if (temporaryPath)
+        snprintf(temporaryPath, length, "%s.%d", compiler.cachePath, (int)getpid());
+
+    if (status == 0 && temporaryPath && fflush(compiler.cache) == 0 && !ferror(compiler.cache) && linkat(AT_FDCWD, procPath, AT_FDCWD, temporaryPath, AT_SYMLINK_FOLLOW) == 0)
+    {
+        if (rename(temporaryPath, compiler.cachePath) == 0)
+        {
+            LOG_DEBUG("Compiled script to %s\n", compiler.cachePath);
+        }
+        else
+        {
+            LOG_DEBUG("Failed to write the compiled script %s: %s\n", compiler.cachePath, strerror(errno));
+            unlink(temporaryPath);
+        }
+    }
+    else
+    {
+        LOG_DEBUG("Failed to write the compiled script %s\n", compiler.cachePath);
+    }
+
+    free(temporaryPath);
+    closeCompiler();
+}
+
+/*-------------------------------Reading--------------------------------------------------*/
+
+static int readNumber(FILE* cache, uint32_t* number)
+{
+    return fread(number, sizeof(*number), 1, cache) == 1 ? 0 : -1;
+}
+
+static int readOffset(FILE* cache, uint64_t* offset)
+{
+    return fread(offset, sizeof(*offset), 1, cache) == 1 ? 0 : -1;
+}
+
+static int readString(FILE* cache, Arena* arena, char** str)
+{
+    uint32_t length;
+    if (readNumber(cache, &length))
+        return -1;
+
+    if (length == NO_STRING)
+    {
+        *str = NULL;
+        return 0;
+    }
+
+    *str = (char*)arenaAlloc(arena, (size_t)length + 1);
+    if (!*str || fread(*str, 1, length, cache) != length)
+        return -1;
+
+    (*str)[length] = '\0';
+    return 0;
+}
+
+static SimpleCommand* readSimpleCommand(FILE* cache, Arena* arena)
+{
+    SimpleCommand* simpleCommand = initSimpleCommand(arena);
+    uint32_t nWords;
+    if (!simpleCommand || readNumber(cache, &nWords))
+        return NULL;
+
+    // the words are read straight into an array of the right size
+    simpleCommand->words = (Word*)arenaAlloc(arena, nWords * sizeof(Word));
+    if (!simpleCommand->words)
+        return NULL;
+    simpleCommand->nWords = nWords;
+    simpleCommand->wordsCapacity = nWords;
+
+    for (uint32_t i = 0; i < nWords; i++)
+    {
+        if (readNumber(cache, &simpleCommand->words[i].flags) || readString(cache, arena, &simpleCommand->words[i].text))
+            return NULL;
+    }
+
+    uint32_t append;
+    if (readString(cache, arena, &simpleCommand->inputFile) || readString(cache, arena, &simpleCommand->outputFile) || readNumber(cache, &append))
+        return NULL;
+    simpleCommand->append = append;
+
+    return simpleCommand;
+}
+
+static CommandChain* readChain(FILE* cache, Arena* arena)
+{
+    CommandChain* chain = initCommandChain(arena);
+    uint32_t nCommands;
+    if (!chain || readNumber(cache, &nCommands))
+        return NULL;
+
+    for (uint32_t i = 0; i < nCommands; i++)
+    {
+        Command* command = initCommand(arena);
+        uint32_t background, chainingOperator, nSimpleCommands;
+        if (!command || readNumber(cache, &background) || readNumber(cache, &chainingOperator) || readNumber(cache, &nSimpleCommands))
+            return NULL;
+        command->background = background;
+        command->chainingOperator = chainingOperator;
+
+        command->simpleCommands = (SimpleCommand**)arenaAlloc(arena, nSimpleCommands * sizeof(SimpleCommand*));
+        if (!command->simpleCommands)
+            return NULL;
+        command->capacity = nSimpleCommands;
+
+        for (uint32_t j = 0; j < nSimpleCommands; j++)
+        {
+            command->simpleCommands[j] = readSimpleCommand(cache, arena);
+            if (!command->simpleCommands[j])
+                return NULL;
+            command->nSimpleCommands++;
+        }
+
+        addCommandToChain(chain, command);
+    }
+
+    if (compileCommandChain(arena, chain))
+        return NULL;
+
+    return chain;
+}
+
+int readCompiledLine(FILE* cache, Arena* arena, char** line, CommandChain** chain, long* offset)
+{
+    uint32_t parsed;
+    uint64_t nextOffset;
+    *chain = NULL;
+
+    // at the end of the cache, nothing of the next record is there
+    int c = getc(cache);
+    if (c == EOF)
+        return -1;
+    ungetc(c, cache);
+
+    // a record is only used once all of it was read, a cache that was cut short or damaged is read up to the last complete line. every line takes up at least its newline, so the offsets only go up
+    if (readString(cache, arena, line) || !*line || readNumber(cache, &parsed) || (parsed && !(*chain = readChain(cache, arena))) || readOffset(cache, &nextOffset) || nextOffset <= (uint64_t)*offset || nextOffset > LONG_MAX)
+    {
+        LOG_DEBUG("Compiled script is corrupt, reading the script from offset %ld\n", *offset);
+        *chain = NULL;
+        return -1;
+    }
+
+    *offset = nextOffset;
+    return 0;
+}
+
+/*-------------------------------Opening--------------------------------------------------*/
+
+// a cache is only trusted if nobody but us could have written it. it is read from a file next to the script, which anyone who can write to the script's directory (e.g. /tmp) can plant, and the header it is matched on is no secret
+static bool isCacheTrusted(int fd)
+{
+    struct stat cacheStat;
+    return fstat(fd, &cacheStat) == 0 && S_ISREG(cacheStat.st_mode) && cacheStat.st_uid == geteuid() && !(cacheStat.st_mode & (S_IWGRP | S_IWOTH));
+}
+
+FILE* openScriptCache(const char* scriptPath, FILE* script)
+{
+    // only regular files are cached. anything else (a pipe, a terminal) can't be read twice
+    struct stat scriptStat;
+    if (fstat(fileno(script), &scriptStat) == -1 || !S_ISREG(scriptStat.st_mode))
+        return NULL;
+
+    ScriptCacheHeader expected;
+    makeHeader(&expected, &scriptStat);
+
+    char* cachePath = getCachePath(scriptPath);
+    if (!cachePath)
+        return NULL;
+
+    // an up to date cache is used as it is
+    int fd = open(cachePath, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    FILE* cache = fd != -1 ? fdopen(fd, "r") : NULL;
+    if (cache)
+    {
+        ScriptCacheHeader header;
+        if (isCacheTrusted(fd) && fread(&header, sizeof(header), 1, cache) == 1 && memcmp(&header, &expected, sizeof(header)) == 0)
+        {
+            LOG_DEBUG("Using compiled script %s\n", cachePath);
+            free(cachePath);
+            return cache;
+        }
+        fclose(cache);
+    }
+    else if (fd != -1)
+    {
+        close(fd);
+    }
+
+    // timestamps are coarse, a change in the same tick as the compile wouldn't change the mtime. a script is only compiled if it was last changed a while before
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (scriptStat.st_mtim.tv_sec >= now.tv_sec - 1)
+        LOG_DEBUG("%s was changed too recently to be compiled\n", scriptPath);
+    else
+        openCompiler(cachePath, script, &expected);
+
+    free(cachePath);
+    return NULL;
+}
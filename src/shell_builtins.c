@@ -9,12 +9,24 @@
  *
  */
 
+#define _GNU_SOURCE  // for posix_spawn_file_actions_addtcsetpgrp_np
+
 #include "shell_builtins.h"
 #include "hashtable.h"
+#include "jobs.h"
+#include "dispatch.h"
+#include "output.h"
+#include "variables.h"
+#include "input.h"
+#include "spawn_server.h"
+#include "script_cache.h"
 
 #include <errno.h>
 #include <sys/wait.h>
+#include <spawn.h>
+#include <sys/stat.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <readline/readline.h>
 #include <readline/history.h>
 
@@ -22,84 +34,230 @@
 extern hashtable *aliases;
 
 // stores the original stdin and stdout fds
-extern int originalStdoutFD;
-extern int originalStdinFD;
 extern FILE* script;
+extern char** environ;
 
-/*-------------------------------File Desc Manipulators----------------------------------*/
+/*-------------------------------Output------------------------------------------------*/
+
+// flushes a builtin's output sink, reporting a failed write
+static int finishOutput(OutputSink *sink, const char *builtin)
+{
+    if (sinkFlush(sink) == -1)
+    {
+        LOG_ERROR("%s: write error: %s\n", builtin, strerror(sink->error));
+        return -1;
+    }
+    return 0;
+}
+
+/*-------------------------------Command Location Cache----------------------------------*/
+
+// searched when PATH isn't set, same as execvp's default
+#define DEFAULT_PATH "/usr/bin:/bin"
 
 /**
- * @brief Sets up the file descriptors for a command. Duplicates the file descriptors to stdin, and stdout, and if we are in the parent process, we also save the original stdin and stdout file descriptors.
- *
- * Uses dup2 system call to set up the file descriptors. Returns 0 on success, -1 on failure. Only dups if the file descriptors are not the default ones.
+ * @brief An entry of the command location cache. Maps a command name to the absolute path it was found at in PATH, and counts how often it was used.
  *
- * @param inputFD The input file descriptor
- * @param outputFD The output file descriptor
- * @return int Status code (0 on success, -1 on failure)
  */
-static int setUpFD(int inputFD, int outputFD)
+typedef struct CommandLocation
 {
-    LOG_DEBUG("pipe/io's inputFD: %d\n", inputFD);
-    LOG_DEBUG("pipe/io's outputFD: %d\n", outputFD);
+    char *name;     //< command name, NULL for an empty slot
+    char *path;     //< absolute path of the executable
+    int hits;       //< number of times the entry was used
+} CommandLocation;
 
-    if (inputFD != STDIN_FD)
+// the cache is an open addressing table with linear probing. capacity is a power of two, and it's kept at most half full
+static CommandLocation *commandCache = NULL;
+static int commandCacheCapacity = 0;
+static int commandCacheCount = 0;
+
+// the value of PATH the cached locations were resolved with
+static char *commandCachePath = NULL;
+
+// Hash function for strings (djb2)
+static unsigned long hashCommandName(const char *str)
+{
+    unsigned long hash = 5381;
+    int c;
+
+    while ((c = *str++))
+        hash = ((hash << 5) + hash) + c;
+
+    return hash;
+}
+
+// searches PATH for an executable with the given name, returns a malloc'd absolute path or NULL
+static char *searchPath(const char *name, const char *path, bool *cacheable)
+{
+    size_t nameLength = strlen(name);
+    *cacheable = true;
+
+    while (path)
     {
-        originalStdinFD = dup(STDIN_FD);
-        LOG_DEBUG("Saved copy of originalStdin: %d\n", originalStdinFD);
+        const char *end = strchr(path, ':');
+        size_t dirLength = end ? (size_t)(end - path) : strlen(path);
+
+        // an empty entry means the current directory
+        const char *dir = dirLength ? path : ".";
+        if (!dirLength)
+            dirLength = 1;
+
+        char *candidate = malloc(dirLength + nameLength + 2);
+        if (!candidate)
+            return NULL;
 
-        if (dup2(inputFD, STDIN_FD) == -1)
+        memcpy(candidate, dir, dirLength);
+        candidate[dirLength] = '/';
+        memcpy(candidate + dirLength + 1, name, nameLength + 1);
+
+        struct stat info;
+        if (stat(candidate, &info) == 0 && S_ISREG(info.st_mode) && access(candidate, X_OK) == 0)
         {
-            LOG_DEBUG("dup2: %s\n", strerror(errno));
-            return -1;
+            // a match in a relative directory depends on the current directory, so it can't be remembered
+            *cacheable = dir[0] == '/';
+            return candidate;
         }
+        free(candidate);
 
-        close(inputFD);
+        path = end ? end + 1 : NULL;
     }
 
-    if (outputFD != STDOUT_FD)
-    {
-        originalStdoutFD = dup(STDOUT_FD);
-        LOG_DEBUG("Saved copy of originalStdout: %d\n", originalStdoutFD);
+    return NULL;
+}
 
-        if (dup2(outputFD, STDOUT_FD) == -1)
-        {
-            LOG_DEBUG("dup2: %s\n", strerror(errno));
-            return -1;
-        }
+// returns the slot for a name, either the one holding it or the empty one where it belongs
+static CommandLocation *findCommandSlot(const char *name)
+{
+    unsigned long mask = commandCacheCapacity - 1;
+    unsigned long index = hashCommandName(name) & mask;
+
+    while (commandCache[index].name && strcmp(commandCache[index].name, name) != 0)
+        index = (index + 1) & mask;
+
+    return &commandCache[index];
+}
 
-        close(outputFD);
+// doubles the capacity of the cache, rehashing the entries
+static int growCommandCache(void)
+{
+    CommandLocation *old = commandCache;
+    int oldCapacity = commandCacheCapacity;
+
+    int capacity = oldCapacity ? oldCapacity * 2 : 64;
+    CommandLocation *table = calloc(capacity, sizeof(CommandLocation));
+    if (!table)
+        return -1;
+
+    commandCache = table;
+    commandCacheCapacity = capacity;
+
+    for (int i = 0; i < oldCapacity; i++)
+    {
+        if (old[i].name)
+            *findCommandSlot(old[i].name) = old[i];
     }
+    free(old);
 
     return 0;
 }
 
+void clearCommandCache(void)
+{
+    for (int i = 0; i < commandCacheCapacity; i++)
+    {
+        free(commandCache[i].name);
+        free(commandCache[i].path);
+    }
+    free(commandCache);
+    commandCache = NULL;
+    commandCacheCapacity = 0;
+    commandCacheCount = 0;
+
+    free(commandCachePath);
+    commandCachePath = NULL;
+}
+
 /**
- * @brief Resets the file descriptors to the default ones (stdin and stdout).
+ * @brief Finds the absolute path of a command, from the cache if possible, else by searching PATH once and remembering the result. Names containing a '/' are returned as they are.
  *
- * @return void
+ * @param name The command name
+ * @param hit Whether the lookup counts as a use of the command (for `hash` hit counts)
+ * @return const char* The path of the executable, NULL if it wasn't found. Owned by the cache.
  */
-static void resetFD()
+static const char *lookupCommand(const char *name, bool hit)
 {
-    if (originalStdinFD != STDIN_FD)
+    if (strchr(name, '/'))
+        return name;
+
+    // the cache is only valid for the PATH it was built with
+    const char *path = getenv("PATH");
+    if (!path)
+        path = DEFAULT_PATH;
+
+    if (commandCachePath && strcmp(commandCachePath, path) != 0)
+        clearCommandCache();
+
+    if (!commandCachePath)
+        commandCachePath = COPY(path);
+
+    CommandLocation *entry = commandCacheCapacity ? findCommandSlot(name) : NULL;
+    if (entry && entry->name)
     {
-        if (dup2(originalStdinFD, STDIN_FD) == -1)
-        {
-            LOG_ERROR("dup2: %s\n", strerror(errno));
-            exit(1);
-        }
-        close(originalStdinFD);
-        originalStdinFD = STDIN_FD;
+        entry->hits += hit;
+        return entry->path;
     }
 
-    if (originalStdoutFD != STDOUT_FD)
+    bool cacheable;
+    char *location = searchPath(name, path, &cacheable);
+    if (!location)
+        return NULL;
+
+    if (!cacheable || ((commandCacheCount + 1) * 2 > commandCacheCapacity && growCommandCache()))
     {
-        if (dup2(originalStdoutFD, STDOUT_FD) == -1)
-        {
-            LOG_ERROR("dup2: %s\n", strerror(errno));
-            exit(1);
-        }
-        close(originalStdoutFD);
-        originalStdoutFD = STDOUT_FD;
+        // hand out a path that isn't remembered. it stays valid until the next uncached lookup
+        static char *uncached = NULL;
+        free(uncached);
+        uncached = location;
+        return uncached;
+    }
+
+    entry = findCommandSlot(name);
+    entry->name = COPY(name);
+    entry->path = location;
+    entry->hits = hit;
+    commandCacheCount++;
+
+    return entry->path;
+}
+
+// drops the cached location of a command, e.g. because the executable is gone. the slot is kept, and filled again on the next lookup
+static void forgetCommand(const char *name)
+{
+    CommandLocation *entry = commandCacheCapacity ? findCommandSlot(name) : NULL;
+    if (!entry || !entry->name)
+        return;
+
+    char *location = searchPath(name, commandCachePath, &(bool){true});
+    if (location)
+    {
+        free(entry->path);
+        entry->path = location;
+        return;
+    }
+
+    // not in PATH anymore, remove the entry and reinsert the rest of its cluster, so that probing still finds them
+    free(entry->name);
+    free(entry->path);
+    entry->name = NULL;
+    entry->path = NULL;
+    commandCacheCount--;
+
+    unsigned long mask = commandCacheCapacity - 1;
+    for (unsigned long index = (entry - commandCache + 1) & mask; commandCache[index].name; index = (index + 1) & mask)
+    {
+        CommandLocation moved = commandCache[index];
+        commandCache[index].name = NULL;
+        *findCommandSlot(moved.name) = moved;
     }
 }
 
@@ -150,34 +308,29 @@ int pwd(SimpleCommand *simpleCommand)
         return -1;
     }
 
-    if (setUpFD(simpleCommand->inputFD, simpleCommand->outputFD))
-    {
-        return -1;
-    }
+    OutputSink sink;
+    initOutputSink(&sink, simpleCommand->outputFD);
+    sinkPuts(&sink, cwd);
+    sinkWrite(&sink, "\n", 1);
 
-    printf("%s\n", cwd);
-    fflush(stdout);
-    resetFD();
-    return 0;
+    return finishOutput(&sink, "pwd");
 }
 
 int echo(SimpleCommand *simpleCommand)
 {
-    if (setUpFD(simpleCommand->inputFD, simpleCommand->outputFD))
-    {
-        return -1;
-    }
+    // the args are written with a single write in the common case
+    OutputSink sink;
+    initOutputSink(&sink, simpleCommand->outputFD);
 
-    for (int i = 1; i < simpleCommand->argc - 1; i++)
+    for (int i = 1; i < simpleCommand->argc; i++)
     {
-        printf("%s ", simpleCommand->args[i]);
+        sinkPuts(&sink, simpleCommand->args[i]);
+        sinkWrite(&sink, i < simpleCommand->argc - 1 ? " " : "\n", 1);
     }
-    printf("%s\n", simpleCommand->args[simpleCommand->argc - 1]);
-    fflush(stdout);
-
-    resetFD();
+    if (simpleCommand->argc == 1)
+        sinkWrite(&sink, "\n", 1);
 
-    return 0;
+    return finishOutput(&sink, "echo");
 }
 
 int exitShell(SimpleCommand *simpleCommand)
@@ -188,20 +341,29 @@ int exitShell(SimpleCommand *simpleCommand)
         return -1;
     }
 
-    printf("Exiting shell\n");
+    // other shells leave a script or a -c string silently
+    if (mode == INTERACTIVE_MODE)
+        printf("Exiting shell\n");
 
-    if (script)
-        fclose(script);
-    
+    // a bare exit leaves with the status of the last command
     if (simpleCommand->argc == 1)
-        exit(0);
+        terminateShell(getLastStatus());
 
     if (strspn(simpleCommand->args[1], "1234567890") == strlen(simpleCommand->args[1]))
-        exit(atoi(simpleCommand->args[1]));
+        terminateShell(atoi(simpleCommand->args[1]));
 
     return 0;
 }
 
+void terminateShell(int status)
+{
+    finishScriptCache();
+    if (script)
+        fclose(script);
+
+    exit(status);
+}
+
 int alias(SimpleCommand *simpleCommand)
 {
     // alias usage:
@@ -215,15 +377,13 @@ int alias(SimpleCommand *simpleCommand)
         return -1;
     }
 
-    if (setUpFD(simpleCommand->inputFD, simpleCommand->outputFD))
-    {
-        return -1;
-    }
+    OutputSink sink;
+    initOutputSink(&sink, simpleCommand->outputFD);
 
     if (simpleCommand->argc == 1)
     {
         // No arguments, list all aliases
-        printHashtable(aliases);
+        printHashtable(aliases, &sink);
     }
     else if (simpleCommand->argc == 2)
     {
@@ -232,7 +392,7 @@ int alias(SimpleCommand *simpleCommand)
         const char *value = get(aliases, key);
 
         if (value)
-            printf("%s=\'%s\'\n", key, value);
+            sinkPrintf(&sink, "%s=\'%s\'\n", key, value);
     }
     else
     {
@@ -240,12 +400,14 @@ int alias(SimpleCommand *simpleCommand)
         const char *key = simpleCommand->args[1];
         const char *value = simpleCommand->args[2];
 
-        set(aliases, key, value);
+        if (set(aliases, key, value))
+        {
+            LOG_ERROR("alias: %s: %s\n", key, strerror(errno));
+            return -1;
+        }
     }
-    fflush(stdout);
-    resetFD();
 
-    return 0;
+    return finishOutput(&sink, "alias");
 }
 
 int unalias(SimpleCommand *simpleCommand)
@@ -266,19 +428,95 @@ int unalias(SimpleCommand *simpleCommand)
     }
 
     const char *key = simpleCommand->args[1];
-    const char *value = get(aliases, key);
 
-    if (!value)
+    // the entry is removed from the table, not just emptied
+    if (removeKey(aliases, key))
     {
         LOG_ERROR("unalias: %s: not found\n", key);
         return -1;
     }
 
-    set(aliases, key, NULL);
-
     return 0;
 }
 
+int exportVariables(SimpleCommand *simpleCommand)
+{
+    // export usage:
+    // export [-p] : lists the exported variables
+    // export name[=value]... : exports the variables, assigning them first if a value is given
+
+    if (simpleCommand->argc == 1 || (simpleCommand->argc == 2 && strcmp(simpleCommand->args[1], "-p") == 0))
+    {
+        OutputSink sink;
+        initOutputSink(&sink, simpleCommand->outputFD);
+        printExportedVariables(&sink);
+        return finishOutput(&sink, "export");
+    }
+
+    int status = 0;
+    for (int i = 1; i < simpleCommand->argc; i++)
+    {
+        char *arg = simpleCommand->args[i];
+        size_t nameLength = variableNameLength(arg);
+        if (nameLength == 0 || (arg[nameLength] != '\0' && arg[nameLength] != '='))
+        {
+            LOG_ERROR("export: %s: bad variable name\n", arg);
+            status = 1;
+            continue;
+        }
+
+        // the arg is split at its '=' in place, the value is set before the variable is exported so that the environment is updated once
+        int failed;
+        if (arg[nameLength] == '=')
+        {
+            arg[nameLength] = '\0';
+            failed = setVariable(arg, arg + nameLength + 1) || exportVariable(arg);
+            arg[nameLength] = '=';
+        }
+        else
+        {
+            failed = exportVariable(arg);
+        }
+
+        if (failed)
+        {
+            LOG_ERROR("export: %s: %s\n", arg, strerror(errno));
+            status = 1;
+        }
+    }
+
+    return status;
+}
+
+int unsetVariables(SimpleCommand *simpleCommand)
+{
+    // unset usage:
+    // unset [-v] name... : unsets the variables
+
+    int status = 0;
+    for (int i = 1; i < simpleCommand->argc; i++)
+    {
+        char *name = simpleCommand->args[i];
+        if (i == 1 && strcmp(name, "-v") == 0)
+            continue;
+
+        if (variableNameLength(name) != strlen(name))
+        {
+            LOG_ERROR("unset: %s: bad variable name\n", name);
+            status = 1;
+            continue;
+        }
+
+        if (unsetVariable(name))
+        {
+            LOG_ERROR("unset: %s: %s\n", name, strerror(errno));
+            status = 1;
+        }
+    }
+
+    return status;
+}
+
 int history(SimpleCommand *simpleCommand)
 {
     if (simpleCommand->argc > 1)
@@ -294,83 +532,656 @@ int history(SimpleCommand *simpleCommand)
         return -1;
     }
 
-    if (setUpFD(simpleCommand->inputFD, simpleCommand->outputFD))
+    OutputSink sink;
+    initOutputSink(&sink, simpleCommand->outputFD);
+
+    for (int i = 0; historyList[i] != NULL; i++)
+    {
+        sinkPrintf(&sink, "%d %s\n", i + 1, historyList[i]->line);
+    }
+
+    return finishOutput(&sink, "history");
+}
+
+int jobs(SimpleCommand *simpleCommand)
+{
+    if (simpleCommand->argc > 1)
+    {
+        LOG_ERROR("jobs: Too many arguments\n");
+        return -1;
+    }
+
+    reapJobs();
+
+    OutputSink sink;
+    initOutputSink(&sink, simpleCommand->outputFD);
+
+    for (Job *job = getJobs(); job; job = job->next)
     {
+        // jobs without processes are builtins running in the shell, like this one
+        if (job->nProcesses == 0)
+            continue;
+
+        JobState state = getJobState(job);
+        if (state == JOB_RUNNING)
+            sinkPrintf(&sink, "[%d]%c  %-24s%s &\n", job->id, getJobMarker(job), "Running", job->commandLine);
+        else if (state == JOB_STOPPED)
+            sinkPrintf(&sink, "[%d]%c  %-24s%s\n", job->id, getJobMarker(job), "Stopped", job->commandLine);
+        else
+            sinkPrintf(&sink, "[%d]%c  %-24s%s\n", job->id, getJobMarker(job), "Done", job->commandLine);
+
+        // finished jobs have now been reported, and are dropped at the next notification
+        job->notified = true;
+    }
+
+    return finishOutput(&sink, "jobs");
+}
+
+int fg(SimpleCommand *simpleCommand)
+{
+    if (simpleCommand->argc > 2)
+    {
+        LOG_ERROR("fg: Too many arguments\n");
         return -1;
     }
 
-    for (int i = 0; historyList[i] != NULL; i++)
+    reapJobs();
+
+    Job *job = findJob(simpleCommand->argc == 2 ? simpleCommand->args[1] : NULL);
+    if (!job || getJobState(job) == JOB_DONE)
     {
-        printf("%d %s\n", i + 1, historyList[i]->line);
+        LOG_ERROR("fg: %s: no such job\n", simpleCommand->argc == 2 ? simpleCommand->args[1] : "current");
+        return -1;
     }
 
-    resetFD();
+    // the job's line is written out before the job runs. a failed write is reported, but the job is still continued
+    OutputSink sink;
+    initOutputSink(&sink, simpleCommand->outputFD);
+    sinkPrintf(&sink, "%s\n", job->commandLine);
+    finishOutput(&sink, "fg");
 
-    return 0;
+    if (continueJob(job, true))
+        return -1;
+
+    int status = waitForJob(job);
+    if (getJobState(job) == JOB_DONE)
+        removeJob(job);
+
+    return status;
 }
 
-int executeProcess(SimpleCommand *simpleCommand)
+int bg(SimpleCommand *simpleCommand)
 {
-    int pid = fork();
+    if (simpleCommand->argc > 2)
+    {
+        LOG_ERROR("bg: Too many arguments\n");
+        return -1;
+    }
 
-    if (pid == -1)
+    reapJobs();
+
+    Job *job = findJob(simpleCommand->argc == 2 ? simpleCommand->args[1] : NULL);
+    if (!job || getJobState(job) == JOB_DONE)
     {
-        // FO'KING ERROR (me when Bri'ish)
-        LOG_ERROR("fork: %s\n", strerror(errno));
+        LOG_ERROR("bg: %s: no such job\n", simpleCommand->argc == 2 ? simpleCommand->args[1] : "current");
         return -1;
     }
-    else if (pid == 0)
+
+    OutputSink sink;
+    initOutputSink(&sink, simpleCommand->outputFD);
+    sinkPrintf(&sink, "[%d]%c %s &\n", job->id, getJobMarker(job), job->commandLine);
+    int status = finishOutput(&sink, "bg");
+
+    return continueJob(job, false) ? -1 : status;
+}
+
+int waitForJobs(SimpleCommand *simpleCommand)
+{
+    // wait usage:
+    // wait : waits for all background jobs, returns 0
+    // wait job... : waits for the given jobs (%n or pid), returns the status of the last one
+
+    if (simpleCommand->argc == 1)
     {
-        // Duplicate the FDs. Default FDs are STDIN AND STDOUT but, if pipes or  < > are used, the FDs are updated in the parsing step, by opening the relevant file or creating relevant pipes
-        setUpFD(simpleCommand->inputFD, simpleCommand->outputFD);
+        // all the running jobs are waited on at once
+        int nJobs = 0;
+        for (Job *job = getJobs(); job; job = job->next)
+            nJobs++;
 
-        // Execute the command
-        if (execvp(simpleCommand->commandName, simpleCommand->args) == -1)
+        Job **running = (Job **)malloc((nJobs ? nJobs : 1) * sizeof(Job *));
+        if (!running)
         {
-            LOG_ERROR("%s: %s\n", simpleCommand->commandName, strerror(errno));
-            exit(1);
+            LOG_ERROR("wait: %s\n", strerror(errno));
+            return -1;
         }
 
-        // This should never be reached
-        LOG_ERROR("This should never be reached\n");
-        exit(1);
+        int nRunning = 0;
+        for (Job *job = getJobs(); job; job = job->next)
+        {
+            if (job->nProcesses > 0 && getJobState(job) == JOB_RUNNING)
+                running[nRunning++] = job;
+        }
+        int result = awaitJobs(running, nRunning, -1);
+        free(running);
+
+        Job *job = getJobs();
+        while (job)
+        {
+            Job *next = job->next;
+            if (job->nProcesses > 0 && getJobState(job) == JOB_DONE)
+                removeJob(job);
+            job = next;
+        }
+        return result > 1 ? result : 0;
+    }
+
+    int status = 0;
+    for (int i = 1; i < simpleCommand->argc; i++)
+    {
+        Job *job = findJob(simpleCommand->args[i]);
+        if (!job)
+        {
+            LOG_ERROR("wait: %s: no such job\n", simpleCommand->args[i]);
+            status = 127;
+            continue;
+        }
+
+        status = waitForJob(job);
+        if (getJobState(job) == JOB_DONE)
+            removeJob(job);
+    }
+
+    return status;
+}
+
+int hashCommands(SimpleCommand *simpleCommand)
+{
+    // hash usage:
+    // hash : lists the remembered command locations, with their hit counts
+    // hash -r : forgets all remembered locations
+    // hash name... : looks up the commands and remembers their locations
+
+    if (simpleCommand->argc == 2 && strcmp(simpleCommand->args[1], "-r") == 0)
+    {
+        clearCommandCache();
+        return 0;
+    }
+
+    if (simpleCommand->argc > 1)
+    {
+        int status = 0;
+        for (int i = 1; i < simpleCommand->argc; i++)
+        {
+            if (getExecutionFunction(simpleCommand->args[i]) != executeProcess)
+                continue;
+
+            if (!lookupCommand(simpleCommand->args[i], false))
+            {
+                LOG_ERROR("hash: %s: not found\n", simpleCommand->args[i]);
+                status = 1;
+            }
+        }
+        return status;
+    }
+
+    OutputSink sink;
+    initOutputSink(&sink, simpleCommand->outputFD);
+
+    if (commandCacheCount == 0)
+    {
+        sinkPuts(&sink, "hash: hash table empty\n");
     }
     else
     {
-        // Parent process
-        simpleCommand->pid = pid;
+        sinkPuts(&sink, "hits\tcommand\n");
+        for (int i = 0; i < commandCacheCapacity; i++)
+        {
+            if (commandCache[i].name)
+                sinkPrintf(&sink, "%4d\t%s\n", commandCache[i].hits, commandCache[i].path);
+        }
+    }
+
+    return finishOutput(&sink, "hash");
+}
 
-        // waiting for the child process to finish
-        int status;
-        LOG_DEBUG("Waiting for child process, with command name %s\n", simpleCommand->commandName);
-        if (waitpid(pid, &status, 0) == -1)
+// starts the process of a simple command through the spawn server when it's running, and with posix_spawn otherwise. returns 0 or an errno, like posix_spawn
+static int spawnProcess(pid_t *pid, const char *path, SimpleCommand *simpleCommand, char **environment, const posix_spawn_file_actions_t *fileActions, const posix_spawnattr_t *attributes)
+{
+    if (spawnServerRunning())
+    {
+        SpawnRequest request = {path, simpleCommand->args, environment, simpleCommand->inputFD, simpleCommand->outputFD, false, 0, -1};
+        if (simpleCommand->job)
         {
-            LOG_ERROR("waitpid: %s\n", strerror(errno));
-            return -1;
+            request.setProcessGroup = isJobInOwnGroup(simpleCommand->job);
+            request.processGroup = simpleCommand->job->pgid;
+            request.terminalFD = getJobTerminal(simpleCommand->job);
         }
 
-        // print the error (if any) from errno
-        if (WEXITSTATUS(status) != 0)
+        int error = requestSpawn(&request, pid);
+
+        // a process whose exec failed is still our child
+        if (error > 0 && *pid > 0)
+            waitpid(*pid, NULL, 0);
+        if (error != -1)
+            return error;
+    }
+
+    return posix_spawn(pid, path, fileActions, attributes, simpleCommand->args, environment);
+}
+
+int executeProcess(SimpleCommand *simpleCommand)
+{
+    // PATH is searched once per command name, and the location is remembered, so that repeated commands exec their absolute path directly instead of trying every PATH entry
+    const char *path = lookupCommand(simpleCommand->commandName, true);
+    if (!path)
+    {
+        LOG_ERROR("%s: command not found\n", simpleCommand->commandName);
+        return 127;
+    }
+
+    // the process is started with posix_spawn, which glibc implements with a vfork-style clone. the child shares our address space until it execs, so the cost doesn't grow with the shell's page tables like fork's does. the fd plumbing and the job setup that a forked child would do are expressed as file actions and attributes instead
+    posix_spawn_file_actions_t fileActions;
+    posix_spawnattr_t attributes;
+    posix_spawn_file_actions_init(&fileActions);
+    posix_spawnattr_init(&attributes);
+
+    // join the pipeline's process group (0 starts a new group led by the process) with job control, and take the terminal if the job is in the foreground
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+    if (simpleCommand->job)
+    {
+        if (isJobInOwnGroup(simpleCommand->job))
         {
-            // LOG_ERROR("%s: %s\n", simpleCommand->commandName, strerror(errno));
-            LOG_DEBUG("Non zero exit status : %d\n", WEXITSTATUS(status));
-            return WEXITSTATUS(status);
+            flags |= POSIX_SPAWN_SETPGROUP;
+            posix_spawnattr_setpgroup(&attributes, simpleCommand->job->pgid);
         }
+
+        // file actions run in order, so the terminal is taken before the dup2s can replace it (a pipe on stdin)
+        int terminal = getJobTerminal(simpleCommand->job);
+        if (terminal != -1)
+            posix_spawn_file_actions_addtcsetpgrp_np(&fileActions, terminal);
+    }
+
+    // Duplicate the FDs. Default FDs are STDIN AND STDOUT but, if pipes or  < > are used, the FDs are updated in the parsing step, by opening the relevant file or creating relevant pipes. The originals are close-on-exec, so they don't leak into the process
+    if (simpleCommand->inputFD != STDIN_FD)
+        posix_spawn_file_actions_adddup2(&fileActions, simpleCommand->inputFD, STDIN_FD);
+    if (simpleCommand->outputFD != STDOUT_FD)
+        posix_spawn_file_actions_adddup2(&fileActions, simpleCommand->outputFD, STDOUT_FD);
+
+    // undo what the shell ignores or catches for itself
+    sigset_t defaultSignals;
+    sigset_t noSignals;
+    getJobSignals(&defaultSignals);
+    sigemptyset(&noSignals);
+    posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+    posix_spawnattr_setsigmask(&attributes, &noSignals);
+    posix_spawnattr_setflags(&attributes, flags);
+
+    // the assignments before the command name only go into the process' environment
+    char **environment = simpleCommand->environment ? simpleCommand->environment : environ;
+
+    // the process reads stdin from where the shell's next line starts, not from the end of what the shell has buffered. a process with its stdin redirected doesn't touch the shell's, which keeps what it has buffered
+    if (simpleCommand->inputFD == STDIN_FD)
+        syncInput();
+
+    // Execute the command
+    pid_t pid;
+    int error = spawnProcess(&pid, path, simpleCommand, environment, &fileActions, &attributes);
+
+    // the remembered location went stale (the executable was moved or deleted), look it up again
+    if (error == ENOENT && path != simpleCommand->commandName)
+    {
+        forgetCommand(simpleCommand->commandName);
+        path = lookupCommand(simpleCommand->commandName, false);
+        if (path)
+            error = spawnProcess(&pid, path, simpleCommand, environment, &fileActions, &attributes);
+    }
+
+    posix_spawn_file_actions_destroy(&fileActions);
+    posix_spawnattr_destroy(&attributes);
+
+    if (error)
+    {
+        LOG_ERROR("%s: %s\n", simpleCommand->commandName, strerror(error));
+        return error == ENOENT ? 127 : 126;
     }
 
-    LOG_DEBUG("Finished executing command %s\n", simpleCommand->commandName);
+    // We don't wait here, the caller reaps the child once every stage of the pipeline has been started
+    simpleCommand->pid = pid;
+    if (simpleCommand->job)
+        addProcessToJob(simpleCommand->job, pid);
+    LOG_DEBUG("Started child process %d, with command name %s\n", pid, simpleCommand->commandName);
+
     return 0;
 }
 
-/**
- * @brief This struct represents the builtin commands of the shell, and their corresponding execution functions.
- *
- */
-typedef struct commandRegistry
+// moves the simple command's FDs onto the shell's stdin and stdout. the replaced descriptors are saved in saved (-1 if one wasn't replaced) when it isn't NULL
+static int applyShellFDs(SimpleCommand *simpleCommand, int saved[2])
 {
-    char *commandName;
-    ExecutionFunction executionFunction;
-} CommandRegistry;
+    const int fds[2] = {simpleCommand->inputFD, simpleCommand->outputFD};
+    const int targets[2] = {STDIN_FD, STDOUT_FD};
+
+    // the offset stdin is left at is the next line's, and anything still buffered for stdout goes where it was meant to
+    fflush(stdout);
+    if (simpleCommand->inputFD == STDIN_FD)
+        syncInput();
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (saved)
+            saved[i] = -1;
+        if (fds[i] == targets[i])
+            continue;
+
+        if ((saved && (saved[i] = fcntl(targets[i], F_DUPFD_CLOEXEC, 10)) == -1) || dup2(fds[i], targets[i]) == -1)
+        {
+            LOG_ERROR("exec: %s\n", strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// puts back the descriptors applyShellFDs replaced
+static void restoreShellFDs(int saved[2])
+{
+    const int targets[2] = {STDIN_FD, STDOUT_FD};
+    for (int i = 0; i < 2; i++)
+    {
+        if (saved[i] != -1)
+        {
+            dup2(saved[i], targets[i]);
+            close(saved[i]);
+        }
+    }
+}
+
+int replaceShell(SimpleCommand *simpleCommand, char **args)
+{
+    const char *path = lookupCommand(args[0], true);
+    if (!path)
+    {
+        LOG_ERROR("%s: command not found\n", args[0]);
+        return 127;
+    }
+
+    int saved[2];
+    if (applyShellFDs(simpleCommand, saved))
+    {
+        restoreShellFDs(saved);
+        return 1;
+    }
+
+    // undo what the shell ignores or catches for itself. exec resets the caught signals on its own, but not the ignored ones or the mask. the shell's are kept, in case the exec fails
+    sigset_t shellSignals;
+    sigset_t noSignals;
+    sigset_t savedMask;
+    struct sigaction savedActions[NSIG];
+    getJobSignals(&shellSignals);
+    sigemptyset(&noSignals);
+    for (int signal = 1; signal < NSIG; signal++)
+    {
+        if (sigismember(&shellSignals, signal) == 1)
+            sigaction(signal, &(struct sigaction){.sa_handler = SIG_DFL}, &savedActions[signal]);
+    }
+    sigprocmask(SIG_SETMASK, &noSignals, &savedMask);
+
+    // the server would be left behind as a child of the new process, which doesn't know to stop it
+    stopSpawnServer();
+    // and the script's compiled form, if it is still being written, would be lost
+    finishScriptCache();
+
+    // the assignments before the command name only go into the process' environment
+    char **environment = simpleCommand->environment ? simpleCommand->environment : environ;
+    execve(path, args, environment);
+
+    // the remembered location went stale, look it up again
+    int error = errno;
+    if (error == ENOENT && path != args[0])
+    {
+        forgetCommand(args[0]);
+        path = lookupCommand(args[0], false);
+        if (path)
+            execve(path, args, environment);
+        error = errno;
+    }
+
+    // still the shell
+    sigprocmask(SIG_SETMASK, &savedMask, NULL);
+    for (int signal = 1; signal < NSIG; signal++)
+    {
+        if (sigismember(&shellSignals, signal) == 1)
+            sigaction(signal, &savedActions[signal], NULL);
+    }
+    restoreShellFDs(saved);
+
+    LOG_ERROR("%s: %s\n", args[0], strerror(error));
+    return error == ENOENT ? 127 : 126;
+}
+
+int execCommand(SimpleCommand *simpleCommand)
+{
+    // without a command, the redirections are the shell's own from now on, e.g. `exec > log`
+    if (simpleCommand->argc == 1)
+        return applyShellFDs(simpleCommand, NULL) ? 1 : 0;
+
+    return replaceShell(simpleCommand, simpleCommand->args + 1);
+}
+
+// exit statuses of timeout, the same as GNU timeout's
+#define TIMEOUT_TIMED_OUT 124
+#define TIMEOUT_FAILED 125
+
+// parses a duration the way GNU timeout does: a number, which may have a fraction, with an optional s, m, h or d suffix. returns it in milliseconds (rounded up, so that a short timeout doesn't become none), -1 if it isn't a duration
+static long parseDuration(const char *text)
+{
+    char *end;
+    errno = 0;
+    double value = strtod(text, &end);
+    if (end == text || errno || !(value >= 0))
+        return -1;
+
+    double multiplier = 1000;
+    if (*end == 'm')
+        multiplier *= 60;
+    else if (*end == 'h')
+        multiplier *= 60 * 60;
+    else if (*end == 'd')
+        multiplier *= 24 * 60 * 60;
+    else if (*end && *end != 's')
+        return -1;
+    if (*end && end[1])
+        return -1;
+
+    // the event loop takes an int, which is good for over 24 days
+    double milliseconds = value * multiplier;
+    if (milliseconds >= INT_MAX)
+        return INT_MAX;
+    long rounded = (long)milliseconds;
+    return rounded < milliseconds ? rounded + 1 : rounded;
+}
+
+// parses a signal given by name (TERM or SIGTERM) or number. returns -1 if it isn't one
+static int parseSignal(const char *text)
+{
+    if (*text >= '0' && *text <= '9')
+    {
+        char *end;
+        long number = strtol(text, &end, 10);
+        return *end || number <= 0 || number >= NSIG ? -1 : (int)number;
+    }
+
+    if (strncmp(text, "SIG", 3) == 0)
+        text += 3;
+    for (int signo = 1; signo < NSIG; signo++)
+    {
+        const char *name = sigabbrev_np(signo);
+        if (name && strcmp(name, text) == 0)
+            return signo;
+    }
+    return -1;
+}
+
+int timeoutCommand(SimpleCommand *simpleCommand)
+{
+    // timeout usage:
+    // timeout [-k duration] [-s signal] [--preserve-status] duration command [args...] : runs the command, and sends it the signal (TERM by default) if it's still running once the duration is over. with -k, it is killed if it's still running that long after the signal
+
+    int signo = SIGTERM;
+    long killAfter = 0;
+    bool preserveStatus = false;
+
+    int i = 1;
+    for (; i < simpleCommand->argc && simpleCommand->args[i][0] == '-' && simpleCommand->args[i][1]; i++)
+    {
+        const char *option = simpleCommand->args[i];
+        if (strcmp(option, "--") == 0)
+        {
+            i++;
+            break;
+        }
+
+        if (strcmp(option, "--preserve-status") == 0)
+        {
+            preserveStatus = true;
+            continue;
+        }
+
+        // the options with a value take it in the next arg, or attached the way getopt has it: -k5, -sKILL, --kill-after=5, --signal=KILL
+        char kind = 0;
+        const char *value = NULL;
+        if (option[1] == 'k' || option[1] == 's')
+        {
+            kind = option[1];
+            value = option[2] ? option + 2 : NULL;
+        }
+        else if (strncmp(option, "--kill-after", 12) == 0 && (option[12] == '=' || !option[12]))
+        {
+            kind = 'k';
+            value = option[12] ? option + 13 : NULL;
+        }
+        else if (strncmp(option, "--signal", 8) == 0 && (option[8] == '=' || !option[8]))
+        {
+            kind = 's';
+            value = option[8] ? option + 9 : NULL;
+        }
+        else
+        {
+            LOG_ERROR("timeout: invalid option -- '%s'\n", option);
+            return TIMEOUT_FAILED;
+        }
+
+        if (!value)
+        {
+            if (i + 1 == simpleCommand->argc)
+            {
+                LOG_ERROR("timeout: option requires an argument -- '%c'\n", kind);
+                return TIMEOUT_FAILED;
+            }
+            value = simpleCommand->args[++i];
+        }
+
+        if (kind == 'k' && (killAfter = parseDuration(value)) == -1)
+        {
+            LOG_ERROR("timeout: invalid time interval '%s'\n", value);
+            return TIMEOUT_FAILED;
+        }
+        if (kind == 's' && (signo = parseSignal(value)) == -1)
+        {
+            LOG_ERROR("timeout: '%s': invalid signal\n", value);
+            return TIMEOUT_FAILED;
+        }
+    }
+
+    if (simpleCommand->argc - i < 2)
+    {
+        LOG_ERROR("timeout: missing operand\n");
+        return TIMEOUT_FAILED;
+    }
+
+    long duration = parseDuration(simpleCommand->args[i]);
+    if (duration == -1)
+    {
+        LOG_ERROR("timeout: invalid time interval '%s'\n", simpleCommand->args[i]);
+        return TIMEOUT_FAILED;
+    }
+
+    Job *job = simpleCommand->job;
+    if (!job)
+    {
+        LOG_ERROR("timeout: can't run a command outside of a job\n");
+        return TIMEOUT_FAILED;
+    }
+
+    // without job control the job is in the shell's process group. the command gets a group of its own then, like GNU timeout gives it, so that the signal reaches whatever it starts and not the shell. with job control, the job's group is already the command's own
+    int jobGroup = job->pgid;
+    bool ownGroup = !isJobInOwnGroup(job);
+    if (ownGroup)
+        job->pgid = 0;
+
+    // the command is started as a process of the builtin's job, like it would be without the timeout, so there's no timeout process in between. its args are the builtin's after the duration
+    char **args = simpleCommand->args;
+    int argc = simpleCommand->argc;
+    char *commandName = simpleCommand->commandName;
+    simpleCommand->args += i + 1;
+    simpleCommand->argc -= i + 1;
+    simpleCommand->commandName = simpleCommand->args[0];
+
+    int status = executeProcess(simpleCommand);
+
+    // addProcessToJob made the command the leader of its group
+    int commandGroup = job->pgid;
+    job->pgid = jobGroup;
+
+    simpleCommand->args = args;
+    simpleCommand->argc = argc;
+    simpleCommand->commandName = commandName;
+    if (status)
+        return status;
+
+    // only the command is waited on, not the other stages of a pipeline the builtin may be part of. the view shares the process with the job, so the job sees its status too. it has the command's group, so the wait collects the command's stops and forwards the shell's signals to the group
+    Process *process = &job->processes[job->nProcesses - 1];
+    Job view = *job;
+    view.processes = process;
+    view.nProcesses = 1;
+    if (ownGroup)
+        view.pgid = commandGroup;
+    Job *waited = &view;
+
+    // the signal goes to the command's process group when it leads one, so that whatever it started gets it too
+    pid_t target = process->pid == view.pgid ? -view.pgid : process->pid;
+
+    bool timedOut = false;
+    int result = awaitJobs(&waited, 1, duration > 0 ? (int)duration : -1);
+    if (result == 1)
+    {
+        timedOut = true;
+        kill(target, signo);
+        // a stopped process has to run to act on the signal
+        if (signo != SIGKILL && signo != SIGCONT)
+            kill(target, SIGCONT);
+
+        result = awaitJobs(&waited, 1, killAfter > 0 ? (int)killAfter : -1);
+        if (result == 1)
+        {
+            kill(target, SIGKILL);
+            result = awaitJobs(&waited, 1, -1);
+        }
+    }
+
+    // the builtin's status is the status of the command, the caller doesn't take it from the process
+    simpleCommand->pid = -1;
+
+    if (result > 1)
+        return result;
+    // a stopped command's status is 128 + the signal that stopped it, like a killed one's
+    if (process->state == JOB_STOPPED)
+        return process->status;
+
+    // like GNU timeout, a command that was killed reports it even without --preserve-status
+    if (timedOut && !preserveStatus && process->status != 128 + SIGKILL)
+        return TIMEOUT_TIMED_OUT;
+    return process->status;
+}
 
 /**
  * @brief Registry of all the commands supported by the shell, and their corresponding execution functions. If a command is not found in the registry, it is assumed to be a process to be executed and the executeProcess function is called. Add new commands here, with their appropriate functions.
@@ -384,17 +1195,30 @@ static const CommandRegistry commandRegistry[] = {
     {"alias", alias},
     {"unalias", unalias},
     {"history", history},
+    {"jobs", jobs},
+    {"fg", fg},
+    {"bg", bg},
+    {"wait", waitForJobs},
+    {"hash", hashCommands},
+    {"export", exportVariables},
+    {"unset", unsetVariables},
+    {"exec", execCommand},
+    {"timeout", timeoutCommand},
     {NULL, NULL}};
 
 ExecutionFunction getExecutionFunction(char *commandName)
 {
-    for (int i = 0; commandRegistry[i].commandName != NULL; i++)
+    // the perfect hash table is built from the registry the first time a command is looked up
+    static DispatchTable dispatchTable = {NULL, 0, 0, NULL};
+    if (!dispatchTable.registry && buildDispatchTable(&dispatchTable, commandRegistry))
     {
-        if (strcmp(commandRegistry[i].commandName, commandName) == 0)
-        {
-            return commandRegistry[i].executionFunction;
-        }
+        LOG_ERROR("Failed to build the builtin dispatch table\n");
+        exit(1);
     }
 
+    const CommandRegistry *entry = lookupDispatchTable(&dispatchTable, commandName);
+    if (entry)
+        return entry->executionFunction;
+
     return executeProcess;
-}
\ No newline at end of file
+}
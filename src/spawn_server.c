@@ -0,0 +1,392 @@
+/**
+ * @file spawn_server.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the spawn server declared in spawn_server.h
+ * @version 0.1
+ * @date 2023-07-31
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#define _GNU_SOURCE  // for clone, CLONE_PARENT and MSG_CMSG_CLOEXEC
+
+#include "spawn_server.h"
+#include "utils.h"
+#include "jobs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// the largest request the server takes. bigger ones (a huge environment, or a wildcard that matched thousands of paths) are spawned by the shell itself
+#define SPAWN_MESSAGE_MAX (128 * 1024)
+
+// the FDs sent with a request: stdin, stdout, stderr, the working directory and the terminal, if the process takes it
+#define SPAWN_MAX_FDS 5
+
+// the stack the clones of the server run on until they exec
+#define SPAWN_STACK_SIZE (64 * 1024)
+
+// the start of a request. the path, the args and the environment follow it, as NUL terminated strings
+typedef struct SpawnHeader
+{
+    uint32_t nArgs;
+    uint32_t nEnvironment;
+    int32_t processGroup;
+    uint8_t setProcessGroup;
+    uint8_t hasTerminal;
+} SpawnHeader;
+
+// the server's answer to a request
+typedef struct SpawnReply
+{
+    int32_t pid;
+    int32_t error;
+} SpawnReply;
+
+// the shell's end of the socketpair, -1 when the server isn't running
+static int serverSocket = -1;
+static pid_t serverPid = -1;
+
+/*-------------------------------Server-----------------------------------------------*/
+
+// a process being started. the clone runs in the server's address space until it execs, so it reads this directly and writes back the error
+typedef struct ChildSetup
+{
+    SpawnHeader header;
+    const char* path;
+    char** args;
+    char** environment;
+    int fds[SPAWN_MAX_FDS];
+    int error;
+} ChildSetup;
+
+static int runChild(void* argument)
+{
+    ChildSetup* setup = (ChildSetup*)argument;
+
+    // stdin, stdout and stderr. the received FDs are close-on-exec, the copies aren't
+    int status = 0;
+    for (int i = 0; i < 3 && status == 0; i++)
+        status = dup2(setup->fds[i], i) == -1 ? -1 : 0;
+    if (status == 0)
+        status = fchdir(setup->fds[3]);
+
+    if (status == 0)
+    {
+        // join the job's process group, and take the terminal if the job is in the foreground. the server ignores SIGTTOU, so the clone can take it from the background
+        if (setup->header.setProcessGroup)
+        {
+            pid_t pgid = setup->header.processGroup ? setup->header.processGroup : getpid();
+            setpgid(0, pgid);
+            if (setup->header.hasTerminal)
+                tcsetpgrp(setup->fds[4], pgid);
+        }
+
+        // undo what the server ignores, like for any other child of the shell
+        sigset_t signals;
+        getJobSignals(&signals);
+        for (int signal = 1; signal < NSIG; signal++)
+        {
+            if (sigismember(&signals, signal) == 1)
+                sigaction(signal, &(struct sigaction){.sa_handler = SIG_DFL}, NULL);
+        }
+        sigemptyset(&signals);
+        sigprocmask(SIG_SETMASK, &signals, NULL);
+
+        execve(setup->path, setup->args, setup->environment);
+    }
+
+    setup->error = errno;
+    _exit(127);
+}
+
+// splits count NUL terminated strings off the front of text into strings, with a NULL after them. returns where they end, NULL if the message ends first
+static char* splitStrings(char* text, const char* end, uint32_t count, char** strings)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        char* nul = (char*)memchr(text, '\0', end - text);
+        if (!nul)
+            return NULL;
+        strings[i] = text;
+        text = nul + 1;
+    }
+    strings[count] = NULL;
+    return text;
+}
+
+// reads a request into setup. returns the number of FDs that came with it, -1 once the shell is gone
+static int receiveRequest(int socket, char* message, char*** strings, size_t* stringsCapacity, ChildSetup* setup)
+{
+    char control[CMSG_SPACE(SPAWN_MAX_FDS * sizeof(int))];
+    struct iovec iov = {message, SPAWN_MESSAGE_MAX};
+    struct msghdr header = {0};
+    header.msg_iov = &iov;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    ssize_t length;
+    do
+        length = recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+    while (length == -1 && errno == EINTR);
+
+    if (length <= 0)
+        return -1;
+
+    int nFDs = 0;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            nFDs = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(setup->fds, CMSG_DATA(cmsg), nFDs * sizeof(int));
+        }
+    }
+
+    // a request that doesn't add up is answered with EINVAL
+    setup->path = NULL;
+    if ((size_t)length < sizeof(SpawnHeader) || nFDs < 4)
+        return nFDs;
+    memcpy(&setup->header, message, sizeof(SpawnHeader));
+    if (setup->header.hasTerminal && nFDs < 5)
+        return nFDs;
+
+    // every string takes a byte at least, so there can't be more of them than bytes
+    char* text = message + sizeof(SpawnHeader);
+    const char* end = message + length;
+    size_t nStrings = (size_t)setup->header.nArgs + setup->header.nEnvironment;
+    if (setup->header.nArgs == 0 || nStrings > (size_t)(end - text))
+        return nFDs;
+
+    if (nStrings + 2 > *stringsCapacity)
+    {
+        char** grown = (char**)realloc(*strings, (nStrings + 2) * sizeof(char*));
+        if (!grown)
+            return nFDs;
+        *strings = grown;
+        *stringsCapacity = nStrings + 2;
+    }
+
+    char* path = text;
+    text = (char*)memchr(text, '\0', end - text);
+    if (!text)
+        return nFDs;
+
+    setup->args = *strings;
+    setup->environment = *strings + setup->header.nArgs + 1;
+    text = splitStrings(text + 1, end, setup->header.nArgs, setup->args);
+    if (text && splitStrings(text, end, setup->header.nEnvironment, setup->environment))
+        setup->path = path;
+
+    return nFDs;
+}
+
+// the server's loop, which answers requests until the shell closes its end of the socket
+static void serve(int socket)
+{
+    char* message = (char*)malloc(SPAWN_MESSAGE_MAX);
+    char* stack = (char*)malloc(SPAWN_STACK_SIZE);
+    char** strings = NULL;
+    size_t stringsCapacity = 0;
+    if (!message || !stack)
+        _exit(1);
+
+    ChildSetup setup;
+    int nFDs;
+    while ((nFDs = receiveRequest(socket, message, &strings, &stringsCapacity, &setup)) != -1)
+    {
+        SpawnReply reply = {-1, EINVAL};
+        if (setup.path)
+        {
+            // the process is made a child of the shell (the server's parent) instead of the server's, so the shell can wait on it. like posix_spawn, the server is suspended until the clone has exec'd
+            setup.error = 0;
+            reply.pid = clone(runChild, stack + SPAWN_STACK_SIZE, CLONE_VM | CLONE_VFORK | CLONE_PARENT | SIGCHLD, &setup);
+            reply.error = reply.pid == -1 ? errno : setup.error;
+        }
+
+        for (int i = 0; i < nFDs; i++)
+            close(setup.fds[i]);
+
+        send(socket, &reply, sizeof(reply), MSG_NOSIGNAL);
+    }
+
+    _exit(0);
+}
+
+int startSpawnServer(void)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1)
+    {
+        LOG_DEBUG("socketpair: %s\n", strerror(errno));
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        LOG_DEBUG("fork: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        close(fds[0]);
+
+        // signals from the terminal are meant for the shell and its jobs
+        sigset_t signals;
+        getJobSignals(&signals);
+        for (int signal = 1; signal < NSIG; signal++)
+        {
+            if (signal != SIGCHLD && sigismember(&signals, signal) == 1)
+                sigaction(signal, &(struct sigaction){.sa_handler = SIG_IGN}, NULL);
+        }
+
+        serve(fds[1]);
+    }
+
+    close(fds[1]);
+    serverSocket = fds[0];
+    serverPid = pid;
+    LOG_DEBUG("Started spawn server %d\n", pid);
+    return 0;
+}
+
+bool spawnServerRunning(void)
+{
+    return serverSocket != -1;
+}
+
+/*-------------------------------Requests---------------------------------------------*/
+
+// appends count strings, NUL terminated, to the message. returns where they end
+static char* copyStrings(char* text, char* const* strings, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        size_t length = strlen(strings[i]) + 1;
+        memcpy(text, strings[i], length);
+        text += length;
+    }
+    return text;
+}
+
+int requestSpawn(const SpawnRequest* request, pid_t* pid)
+{
+    // the message is built in a buffer that is kept for the next request
+    static char* message = NULL;
+
+    if (serverSocket == -1)
+        return -1;
+
+    SpawnHeader header = {0, 0, request->processGroup, request->setProcessGroup, request->terminalFD != -1};
+    size_t length = sizeof(SpawnHeader) + strlen(request->path) + 1;
+    for (; request->args[header.nArgs]; header.nArgs++)
+        length += strlen(request->args[header.nArgs]) + 1;
+    for (; request->environment[header.nEnvironment]; header.nEnvironment++)
+        length += strlen(request->environment[header.nEnvironment]) + 1;
+
+    if (length > SPAWN_MESSAGE_MAX)
+        return -1;
+
+    if (!message)
+    {
+        message = (char*)malloc(SPAWN_MESSAGE_MAX);
+        if (!message)
+            return -1;
+    }
+
+    memcpy(message, &header, sizeof(SpawnHeader));
+    char* text = message + sizeof(SpawnHeader);
+    size_t pathLength = strlen(request->path) + 1;
+    memcpy(text, request->path, pathLength);
+    text = copyStrings(text + pathLength, request->args, header.nArgs);
+    copyStrings(text, request->environment, header.nEnvironment);
+
+    // the server's working directory is the one the shell started in, the process gets the shell's current one
+    int cwd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (cwd == -1)
+        return -1;
+
+    int fds[SPAWN_MAX_FDS] = {request->inputFD, request->outputFD, STDERR_FILENO, cwd, request->terminalFD};
+    int nFDs = header.hasTerminal ? SPAWN_MAX_FDS : SPAWN_MAX_FDS - 1;
+
+    union
+    {
+        char buffer[CMSG_SPACE(SPAWN_MAX_FDS * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov = {message, length};
+    struct msghdr messageHeader = {0};
+    messageHeader.msg_iov = &iov;
+    messageHeader.msg_iovlen = 1;
+    messageHeader.msg_control = control.buffer;
+    messageHeader.msg_controllen = CMSG_SPACE(nFDs * sizeof(int));
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&messageHeader);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(nFDs * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, nFDs * sizeof(int));
+
+    ssize_t sent;
+    do
+        sent = sendmsg(serverSocket, &messageHeader, MSG_NOSIGNAL);
+    while (sent == -1 && errno == EINTR);
+    close(cwd);
+
+    SpawnReply reply;
+    ssize_t received = -1;
+    if (sent != -1)
+    {
+        do
+            received = recv(serverSocket, &reply, sizeof(reply), 0);
+        while (received == -1 && errno == EINTR);
+    }
+
+    // the server is gone. the shell goes on without it
+    if (received != sizeof(reply))
+    {
+        LOG_DEBUG("The spawn server stopped answering\n");
+        stopSpawnServer();
+        return -1;
+    }
+
+    *pid = reply.pid;
+    return reply.error;
+}
+
+void stopSpawnServer(void)
+{
+    if (serverSocket == -1)
+        return;
+
+    // the server exits once it reads the end of the socket
+    close(serverSocket);
+    serverSocket = -1;
+    waitpid(serverPid, NULL, 0);
+    serverPid = -1;
+}
+
+void detachSpawnServer(void)
+{
+    if (serverSocket == -1)
+        return;
+
+    // the server isn't our child, and keeps running for the shell
+    close(serverSocket);
+    serverSocket = -1;
+    serverPid = -1;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file variables.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the symbol table declared in variables.h
+ * @version 0.1
+ * @date 2023-07-26
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "variables.h"
+#include "hashtable.h"
+
+#include <ctype.h>
+
+extern char** environ;
+
+// the values of the set variables, and the names of the exported ones (with empty values)
+static hashtable* values = NULL;
+static hashtable* exported = NULL;
+
+// exit status of the last pipeline
+static int lastStatus = 0;
+
+void initVariables(void)
+{
+    values = createHashtable(HASHTABLE_INITIAL_CAPACITY);
+    exported = createHashtable(HASHTABLE_INITIAL_CAPACITY);
+    if (!values || !exported)
+    {
+        LOG_DEBUG("Failed to allocate memory for the variables\n");
+        return;
+    }
+
+    for (char** entry = environ; entry && *entry; entry++)
+    {
+        const char* equals = strchr(*entry, '=');
+        if (!equals)
+            continue;
+
+        char* name = strndup(*entry, equals - *entry);
+        if (!name)
+            continue;
+
+        if (set(values, name, equals + 1) == 0)
+            set(exported, name, "");
+        free(name);
+    }
+}
+
+void freeVariables(void)
+{
+    deleteHashtable(values);
+    deleteHashtable(exported);
+    values = NULL;
+    exported = NULL;
+}
+
+const char* getVariable(const char* name, size_t length)
+{
+    return values ? getn(values, name, length) : NULL;
+}
+
+int setVariable(const char* name, const char* value)
+{
+    if (!values || set(values, name, value))
+        return -1;
+
+    // only the variable that changed is synced with the environment
+    if (get(exported, name) && setenv(name, value, 1) == -1)
+        return -1;
+
+    return 0;
+}
+
+int exportVariable(const char* name)
+{
+    if (!exported || set(exported, name, ""))
+        return -1;
+
+    const char* value = get(values, name);
+    if (value && setenv(name, value, 1) == -1)
+        return -1;
+
+    return 0;
+}
+
+int unsetVariable(const char* name)
+{
+    if (!values)
+        return 0;
+
+    removeKey(values, name);
+
+    // unsetting a variable drops its export too
+    if (removeKey(exported, name) == 0 && unsetenv(name) == -1)
+        return -1;
+
+    return 0;
+}
+
+// prints an exported variable, with its value if it is set
+static void printExported(const char* name, const char* unused, void* sink)
+{
+    (void)unused;
+    const char* value = get(values, name);
+    if (value)
+        sinkPrintf((OutputSink*)sink, "export %s='%s'\n", name, value);
+    else
+        sinkPrintf((OutputSink*)sink, "export %s\n", name);
+}
+
+void printExportedVariables(OutputSink* sink)
+{
+    if (exported)
+        forEachEntry(exported, printExported, sink);
+}
+
+size_t variableNameLength(const char* str)
+{
+    if (!isalpha((unsigned char)str[0]) && str[0] != '_')
+        return 0;
+
+    size_t length = 1;
+    while (isalnum((unsigned char)str[length]) || str[length] == '_')
+        length++;
+
+    return length;
+}
+
+void setLastStatus(int status)
+{
+    lastStatus = status < 0 ? 1 : status;
+}
+
+int getLastStatus(void)
+{
+    return lastStatus;
+}
@@ -0,0 +1,553 @@
+/**
+ * @file walk.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the directory walk declared in walk.h
+ * @version 0.1
+ * @date 2023-07-29
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#define _GNU_SOURCE  // for O_DIRECTORY and syscall
+
+#include "walk.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// the most threads a walk uses, more don't help a walk that is bound by the filesystem
+#define MAX_WALK_THREADS 16
+
+// the walk is only shared between threads once this many directories are queued. a smaller tree is read by one thread in less time than it takes to start the others
+#define WALK_PARALLEL_THRESHOLD 16
+
+// size of the buffer getdents64 reads the entries of a directory into
+#define DENTS_BUFFER_SIZE (64 * 1024)
+
+// an entry as getdents64 returns it
+struct linuxDirent64
+{
+    ino_t d_ino;
+    off_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// the directories a worker has yet to read. the worker pushes and pops at the tail, thieves take from the head, so they get the directories highest up the tree which have the most work under them
+typedef struct WalkDeque
+{
+    pthread_mutex_t lock;
+    const char** paths;
+    size_t head;
+    size_t tail;
+    size_t capacity;
+} WalkDeque;
+
+typedef struct Walker Walker;
+
+// a thread of the walk, with the entries it found
+typedef struct WalkWorker
+{
+    Walker* walker;
+    int index;
+    WalkDeque deque;
+    Arena arena;            //< the paths of the entries and of the queued directories
+    WalkEntry* entries;
+    size_t count;
+    size_t capacity;
+    char* buffer;           //< for getdents64
+    bool failed;
+} WalkWorker;
+
+struct Walker
+{
+    int rootFD;
+    int nWorkers;
+    WalkWorker* workers;
+    atomic_long pending;    //< directories queued or being read, the walk is over when there are none
+    atomic_int idle;        //< workers waiting for work, on wakeup
+    pthread_mutex_t idleLock;
+    pthread_cond_t wakeup;  //< signalled when directories are queued, or the walk is over
+};
+
+// a thread of the pool, which takes the part of the worker with the same index in every walk it helps with
+typedef struct WalkHelper
+{
+    pthread_t thread;
+    int index;
+    unsigned long generation;   //< the last walk the thread took part in
+} WalkHelper;
+
+// the threads that help the calling thread with its walks. they are started by the first walk that is big enough to share, and wait for the next one in between. a forked child has the pool's memory but none of its threads, so the pool belongs to the process that started it, and a child starts its own
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t start;       //< signalled when a walk is handed out, or the threads are told to stop
+    pthread_cond_t done;        //< signalled when the last helper is done with its part of the walk
+    WalkHelper helpers[MAX_WALK_THREADS - 1];
+    int nHelpers;
+    Walker* walker;             //< the walk being shared
+    unsigned long generation;   //< number of walks handed out
+    int busy;                   //< helpers still working on the walk
+    bool stopping;
+    pid_t owner;
+} pool = {.lock = PTHREAD_MUTEX_INITIALIZER, .start = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER};
+
+/*-------------------------------Deques-----------------------------------------------*/
+
+static int pushDirectory(WalkDeque* deque, const char* path)
+{
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->tail == deque->capacity)
+    {
+        // the taken slots at the head are reused before the array grows
+        size_t count = deque->tail - deque->head;
+        if (deque->head == 0 || count >= deque->capacity / 2)
+        {
+            size_t capacity = deque->capacity ? deque->capacity * 2 : 64;
+            const char** paths = (const char**)realloc(deque->paths, capacity * sizeof(char*));
+            if (!paths)
+            {
+                pthread_mutex_unlock(&deque->lock);
+                return -1;
+            }
+            deque->paths = paths;
+            deque->capacity = capacity;
+        }
+
+        // either way the directories left move to the start
+        memmove(deque->paths, deque->paths + deque->head, count * sizeof(char*));
+        deque->head = 0;
+        deque->tail = count;
+    }
+
+    deque->paths[deque->tail++] = path;
+    pthread_mutex_unlock(&deque->lock);
+    return 0;
+}
+
+// number of directories in a deque. only used before the other workers are started
+static size_t countDirectories(const WalkDeque* deque)
+{
+    return deque->tail - deque->head;
+}
+
+static const char* popDirectory(WalkDeque* deque, bool steal)
+{
+    const char* path = NULL;
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->head < deque->tail)
+        path = steal ? deque->paths[deque->head++] : deque->paths[--deque->tail];
+
+    pthread_mutex_unlock(&deque->lock);
+    return path;
+}
+
+/*-------------------------------Workers----------------------------------------------*/
+
+static int addEntry(WalkWorker* worker, const char* path, unsigned char type)
+{
+    if (worker->count == worker->capacity)
+    {
+        size_t capacity = worker->capacity ? worker->capacity * 2 : 1024;
+        WalkEntry* entries = (WalkEntry*)realloc(worker->entries, capacity * sizeof(WalkEntry));
+        if (!entries)
+            return -1;
+        worker->entries = entries;
+        worker->capacity = capacity;
+    }
+
+    worker->entries[worker->count].path = path;
+    worker->entries[worker->count].type = type;
+    worker->count++;
+    return 0;
+}
+
+// reads a directory, recording its entries and queueing its subdirectories
+static int readDirectory(WalkWorker* worker, const char* path)
+{
+    Walker* walker = worker->walker;
+    int fd = openat(walker->rootFD, *path ? path : ".", O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+
+    size_t pathLength = strlen(path);
+    int status = 0;
+    int queued = 0;
+    long nread;
+    while (status == 0 && (nread = syscall(SYS_getdents64, fd, worker->buffer, DENTS_BUFFER_SIZE)) > 0)
+    {
+        for (long offset = 0; offset < nread && status == 0;)
+        {
+            struct linuxDirent64* dirent = (struct linuxDirent64*)(worker->buffer + offset);
+            offset += dirent->d_reclen;
+
+            const char* name = dirent->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+
+            unsigned char type = dirent->d_type;
+            if (type == DT_UNKNOWN)
+            {
+                struct stat st;
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+                    type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISLNK(st.st_mode) ? DT_LNK : DT_REG;
+            }
+
+            size_t nameLength = strlen(name);
+            char* childPath = (char*)arenaAlloc(&worker->arena, pathLength + nameLength + 2);
+            if (!childPath)
+            {
+                status = -1;
+                break;
+            }
+            if (pathLength)
+            {
+                memcpy(childPath, path, pathLength);
+                childPath[pathLength] = '/';
+                memcpy(childPath + pathLength + 1, name, nameLength + 1);
+            }
+            else
+            {
+                memcpy(childPath, name, nameLength + 1);
+            }
+
+            status = addEntry(worker, childPath, type);
+
+            // hidden directories are listed but not walked into
+            if (status == 0 && type == DT_DIR && name[0] != '.')
+            {
+                atomic_fetch_add(&walker->pending, 1);
+                status = pushDirectory(&worker->deque, childPath);
+                if (status)
+                    atomic_fetch_sub(&walker->pending, 1);
+                else
+                    queued++;
+            }
+        }
+    }
+
+    close(fd);
+
+    // the waiting workers can steal what was queued
+    if (queued && atomic_load(&walker->idle) > 0)
+    {
+        pthread_mutex_lock(&walker->idleLock);
+        if (queued > 1)
+            pthread_cond_broadcast(&walker->wakeup);
+        else
+            pthread_cond_signal(&walker->wakeup);
+        pthread_mutex_unlock(&walker->idleLock);
+    }
+
+    return status;
+}
+
+// the worker's own directories first, depth first, then the ones at the head of the other workers' deques
+static const char* findDirectory(WalkWorker* worker)
+{
+    Walker* walker = worker->walker;
+    const char* path = popDirectory(&worker->deque, false);
+    for (int i = 1; !path && i < walker->nWorkers; i++)
+        path = popDirectory(&walker->workers[(worker->index + i) % walker->nWorkers].deque, true);
+    return path;
+}
+
+// reads a directory, and wakes up the waiting workers if it was the last one of the walk
+static void walkDirectory(WalkWorker* worker, const char* path)
+{
+    Walker* walker = worker->walker;
+    if (readDirectory(worker, path))
+        worker->failed = true;
+
+    if (atomic_fetch_sub(&walker->pending, 1) == 1)
+    {
+        pthread_mutex_lock(&walker->idleLock);
+        pthread_cond_broadcast(&walker->wakeup);
+        pthread_mutex_unlock(&walker->idleLock);
+    }
+}
+
+static void* runWorker(void* argument)
+{
+    WalkWorker* worker = (WalkWorker*)argument;
+    Walker* walker = worker->walker;
+
+    while (true)
+    {
+        const char* path = findDirectory(worker);
+        if (path)
+        {
+            walkDirectory(worker, path);
+            continue;
+        }
+
+        // nothing to take, but a directory that another worker is reading can still add more. the worker sleeps until it does, or the walk is over. it counts itself idle before looking again, so that a directory queued after the look wakes it up
+        pthread_mutex_lock(&walker->idleLock);
+        atomic_fetch_add(&walker->idle, 1);
+        path = findDirectory(worker);
+        bool over = !path && atomic_load(&walker->pending) == 0;
+        if (!path && !over)
+            pthread_cond_wait(&walker->wakeup, &walker->idleLock);
+        atomic_fetch_sub(&walker->idle, 1);
+        pthread_mutex_unlock(&walker->idleLock);
+
+        if (over)
+            break;
+        if (path)
+            walkDirectory(worker, path);
+    }
+
+    return NULL;
+}
+
+/*-------------------------------Pool-------------------------------------------------*/
+
+static void* runHelper(void* argument)
+{
+    WalkHelper* helper = (WalkHelper*)argument;
+
+    pthread_mutex_lock(&pool.lock);
+    while (true)
+    {
+        while (!pool.stopping && pool.generation == helper->generation)
+            pthread_cond_wait(&pool.start, &pool.lock);
+        if (pool.stopping)
+            break;
+
+        // a walk with fewer workers than the pool has threads leaves the rest out
+        helper->generation = pool.generation;
+        Walker* walker = pool.walker;
+        if (helper->index >= walker->nWorkers)
+            continue;
+
+        pthread_mutex_unlock(&pool.lock);
+        runWorker(&walker->workers[helper->index]);
+        pthread_mutex_lock(&pool.lock);
+
+        if (--pool.busy == 0)
+            pthread_cond_signal(&pool.done);
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    return NULL;
+}
+
+// makes sure the pool has the given number of threads, starting the ones it lacks. returns how many it has, up to that number
+static int reserveHelpers(int count)
+{
+    if (pool.owner != getpid())
+    {
+        // the threads of the parent aren't there, and the lock may have been held by one of them when the process forked
+        pthread_mutex_init(&pool.lock, NULL);
+        pthread_cond_init(&pool.start, NULL);
+        pthread_cond_init(&pool.done, NULL);
+        pool.nHelpers = 0;
+        pool.walker = NULL;
+        pool.busy = 0;
+        pool.stopping = false;
+        pool.owner = getpid();
+    }
+
+    // the threads outlive the walk, and block every signal so that they're all left to the shell's own thread, where the wait for a job reads them from its signalfd. a new thread inherits the mask it's created with
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+
+    // a new thread starts out having seen every walk handed out so far
+    while (pool.nHelpers < count)
+    {
+        WalkHelper* helper = &pool.helpers[pool.nHelpers];
+        helper->index = pool.nHelpers + 1;
+        helper->generation = pool.generation;
+        if (pthread_create(&helper->thread, NULL, runHelper, helper) != 0)
+            break;
+        pool.nHelpers++;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    return pool.nHelpers < count ? pool.nHelpers : count;
+}
+
+// walks with the threads of the pool, the calling thread being the first worker. returns once all of them are done
+static void shareWalk(Walker* walker)
+{
+    pthread_mutex_lock(&pool.lock);
+    pool.walker = walker;
+    pool.busy = walker->nWorkers - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+
+    runWorker(&walker->workers[0]);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.busy > 0)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pool.walker = NULL;
+    pthread_mutex_unlock(&pool.lock);
+}
+
+void stopWalkThreads(void)
+{
+    if (pool.owner != getpid() || pool.nHelpers == 0)
+        return;
+
+    pthread_mutex_lock(&pool.lock);
+    pool.stopping = true;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (int i = 0; i < pool.nHelpers; i++)
+        pthread_join(pool.helpers[i].thread, NULL);
+
+    pool.nHelpers = 0;
+    pool.stopping = false;
+}
+
+/*-------------------------------Walk-------------------------------------------------*/
+
+static int comparePaths(const void* a, const void* b)
+{
+    return strcmp(((const WalkEntry*)a)->path, ((const WalkEntry*)b)->path);
+}
+
+int walkTree(const char* root, int nThreads, WalkResult* result)
+{
+    result->entries = NULL;
+    result->count = 0;
+    result->arenas = NULL;
+    result->nArenas = 0;
+
+    if (nThreads <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nThreads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (nThreads > MAX_WALK_THREADS)
+        nThreads = MAX_WALK_THREADS;
+
+    Walker walker;
+    walker.rootFD = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (walker.rootFD == -1)
+        return -1;
+
+    // until the walk is shared, the first worker is the only one
+    walker.nWorkers = 1;
+    walker.workers = (WalkWorker*)calloc(nThreads, sizeof(WalkWorker));
+    result->arenas = (Arena*)calloc(nThreads, sizeof(Arena));
+    if (!walker.workers || !result->arenas)
+    {
+        free(walker.workers);
+        close(walker.rootFD);
+        return -1;
+    }
+    result->nArenas = nThreads;
+    atomic_init(&walker.pending, 1);
+    atomic_init(&walker.idle, 0);
+    pthread_mutex_init(&walker.idleLock, NULL);
+    pthread_cond_init(&walker.wakeup, NULL);
+
+    int status = 0;
+    for (int i = 0; i < nThreads; i++)
+    {
+        WalkWorker* worker = &walker.workers[i];
+        worker->walker = &walker;
+        worker->index = i;
+        pthread_mutex_init(&worker->deque.lock, NULL);
+        initArena(&worker->arena, ARENA_BLOCK_SIZE * 16);
+        worker->buffer = (char*)malloc(DENTS_BUFFER_SIZE);
+        if (!worker->buffer)
+            status = -1;
+    }
+
+    // the root is the first worker's to read, the others steal from it
+    WalkWorker* first = &walker.workers[0];
+    if (status == 0 && pushDirectory(&first->deque, "") == 0)
+    {
+        // the calling thread is the first worker, and walks alone until there's enough queued to share
+        const char* path;
+        while (countDirectories(&first->deque) <= WALK_PARALLEL_THRESHOLD && (path = popDirectory(&first->deque, false)))
+            walkDirectory(first, path);
+
+        if (atomic_load(&walker.pending) > 0)
+        {
+            // a thread that can't be started leaves its share to the others
+            walker.nWorkers = 1 + reserveHelpers(nThreads - 1);
+            if (walker.nWorkers > 1)
+                shareWalk(&walker);
+            else
+                runWorker(first);
+        }
+    }
+    else
+    {
+        status = -1;
+    }
+
+    // the entries of all the workers are merged, and sorted so that the result is the same as a serial walk's
+    size_t total = 0;
+    for (int i = 0; i < nThreads; i++)
+        total += walker.workers[i].count;
+
+    if (status == 0)
+    {
+        result->entries = (WalkEntry*)malloc((total ? total : 1) * sizeof(WalkEntry));
+        if (!result->entries)
+            status = -1;
+    }
+
+    for (int i = 0; i < nThreads; i++)
+    {
+        WalkWorker* worker = &walker.workers[i];
+        if (worker->failed)
+            status = -1;
+
+        if (status == 0)
+        {
+            memcpy(result->entries + result->count, worker->entries, worker->count * sizeof(WalkEntry));
+            result->count += worker->count;
+        }
+
+        result->arenas[i] = worker->arena;
+        free(worker->entries);
+        free(worker->deque.paths);
+        free(worker->buffer);
+        pthread_mutex_destroy(&worker->deque.lock);
+    }
+
+    free(walker.workers);
+    pthread_mutex_destroy(&walker.idleLock);
+    pthread_cond_destroy(&walker.wakeup);
+    close(walker.rootFD);
+
+    if (status == 0)
+        qsort(result->entries, result->count, sizeof(WalkEntry), comparePaths);
+
+    return status;
+}
+
+void freeWalkResult(WalkResult* result)
+{
+    for (int i = 0; i < result->nArenas; i++)
+        destroyArena(&result->arenas[i]);
+
+    free(result->arenas);
+    free(result->entries);
+    result->arenas = NULL;
+    result->entries = NULL;
+    result->nArenas = 0;
+    result->count = 0;
+}
@@ -0,0 +1,632 @@
+/**
+ * @file wildcard.c
+ * @author Abdul Rafay (24100173@lums.edu.pk)
+ * @brief Contains the function definitions for the pathname expansion declared in wildcard.h
+ * @version 0.1
+ * @date 2023-07-28
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "wildcard.h"
+#include "walk.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// number of directory listings kept
+#define DIRECTORY_CACHE_SIZE 32
+
+/*-------------------------------Matching---------------------------------------------*/
+
+bool hasWildcards(const char* word)
+{
+    for (const char* p = word; *p; p++)
+    {
+        if (*p == '*' || *p == '?' || *p == '[')
+            return true;
+        if (*p == '\\' && p[1])
+            p++;
+    }
+    return false;
+}
+
+size_t removeEscapes(char* to, const char* from, size_t length)
+{
+    size_t written = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (from[i] == '\\' && i + 1 < length)
+            i++;
+        to[written++] = from[i];
+    }
+    return written;
+}
+
+// whether a character is in a [:class:] of a bracket expression
+static bool matchClass(const char* name, size_t length, unsigned char c)
+{
+    static const struct
+    {
+        const char* name;
+        int (*test)(int);
+    } classes[] = {
+        {"alnum", isalnum}, {"alpha", isalpha}, {"blank", isblank}, {"cntrl", iscntrl},
+        {"digit", isdigit}, {"graph", isgraph}, {"lower", islower}, {"print", isprint},
+        {"punct", ispunct}, {"space", isspace}, {"upper", isupper}, {"xdigit", isxdigit},
+    };
+
+    for (size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); i++)
+    {
+        if (strlen(classes[i].name) == length && strncmp(classes[i].name, name, length) == 0)
+            return classes[i].test(c);
+    }
+    return false;
+}
+
+// matches a character against the bracket expression at p, and sets its length. returns -1 if there's no closing ']', and the '[' is a literal character
+static int matchBracket(const char* p, const char* end, unsigned char c, size_t* length)
+{
+    const char* q = p + 1;
+    bool negate = q < end && (*q == '!' || *q == '^');
+    q += negate;
+
+    // a ']' right after the '[' (or the negation) is a literal ']'
+    bool matched = false;
+    for (bool first = true; q < end && (*q != ']' || first); first = false)
+    {
+        if (*q == '[' && q + 1 < end && q[1] == ':')
+        {
+            const char* close = q + 2;
+            while (close + 1 < end && !(close[0] == ':' && close[1] == ']'))
+                close++;
+
+            if (close + 1 < end)
+            {
+                matched |= matchClass(q + 2, close - (q + 2), c);
+                q = close + 2;
+                continue;
+            }
+        }
+
+        // an escaped character is an ordinary one
+        if (*q == '\\' && q + 1 < end)
+            q++;
+
+        if (q + 2 < end && q[1] == '-' && q[2] != ']')
+        {
+            matched |= (unsigned char)q[0] <= c && c <= (unsigned char)q[2];
+            q += 3;
+        }
+        else
+        {
+            matched |= (unsigned char)*q == c;
+            q++;
+        }
+    }
+
+    if (q >= end)
+        return -1;
+
+    *length = q + 1 - p;
+    return matched != negate;
+}
+
+bool matchWildcard(const char* pattern, size_t patternLength, const char* name)
+{
+    const char* p = pattern;
+    const char* end = pattern + patternLength;
+    const char* n = name;
+
+    // where the last '*' was, and the name position it is matched up to. on a mismatch the '*' takes one more character and matching resumes after it, which is enough as every other pattern element matches a single character
+    const char* starPattern = NULL;
+    const char* starName = NULL;
+
+    while (*n)
+    {
+        if (p < end && *p == '*')
+        {
+            starPattern = ++p;
+            starName = n;
+            continue;
+        }
+
+        if (p < end)
+        {
+            size_t length = 1;
+            bool matched;
+            if (*p == '?')
+            {
+                matched = true;
+            }
+            else if (*p == '\\' && p + 1 < end)
+            {
+                matched = p[1] == *n;
+                length = 2;
+            }
+            else if (*p == '[')
+            {
+                int result = matchBracket(p, end, *n, &length);
+                matched = result == -1 ? *n == '[' : result;
+            }
+            else
+            {
+                matched = *p == *n;
+            }
+
+            if (matched)
+            {
+                p += length;
+                n++;
+                continue;
+            }
+        }
+
+        if (!starPattern)
+            return false;
+
+        p = starPattern;
+        n = ++starName;
+    }
+
+    while (p < end && *p == '*')
+        p++;
+
+    return p == end;
+}
+
+/*-------------------------------Directory listings-----------------------------------*/
+
+// a name in a directory listing
+typedef struct ListingEntry
+{
+    size_t offset;      //< offset of the name in the listing's names
+    unsigned char type; //< d_type of the entry
+} ListingEntry;
+
+// the names in a directory, as they were when its mtime was the one recorded
+typedef struct DirectoryListing
+{
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    bool reusable;          //< whether the directory was unchanged for long enough that a change would show in its mtime
+    bool cached;            //< whether the listing is in the cache, or a one-off
+    int pins;               //< number of expansions iterating over the listing, it isn't evicted while they do
+    unsigned long lastUse;  //< for evicting the least recently used listing
+    char* names;            //< the names, NUL separated
+    ListingEntry* entries;
+    size_t count;
+} DirectoryListing;
+
+static DirectoryListing directoryCache[DIRECTORY_CACHE_SIZE];
+static unsigned long useCounter = 0;
+
+static void freeListing(DirectoryListing* listing)
+{
+    free(listing->names);
+    free(listing->entries);
+    listing->names = NULL;
+    listing->entries = NULL;
+    listing->count = 0;
+}
+
+// reads the names in a directory into a listing
+static int readListing(const char* path, DirectoryListing* listing)
+{
+    DIR* dir = opendir(path);
+    if (!dir)
+        return -1;
+
+    size_t namesLength = 0, namesCapacity = 0, entriesCapacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)))
+    {
+        size_t length = strlen(entry->d_name) + 1;
+        if (namesLength + length > namesCapacity || listing->count == entriesCapacity)
+        {
+            size_t newNames = namesCapacity ? namesCapacity : 1024;
+            while (newNames < namesLength + length)
+                newNames *= 2;
+            size_t newEntries = entriesCapacity ? entriesCapacity * 2 : 64;
+
+            char* names = (char*)realloc(listing->names, newNames);
+            if (names)
+                listing->names = names;
+            ListingEntry* entries = (ListingEntry*)realloc(listing->entries, newEntries * sizeof(ListingEntry));
+            if (entries)
+                listing->entries = entries;
+
+            if (!names || !entries)
+            {
+                LOG_DEBUG("Failed to allocate memory for the listing of %s\n", path);
+                closedir(dir);
+                freeListing(listing);
+                return -1;
+            }
+            namesCapacity = newNames;
+            entriesCapacity = newEntries;
+        }
+
+        memcpy(listing->names + namesLength, entry->d_name, length);
+        listing->entries[listing->count].offset = namesLength;
+        listing->entries[listing->count].type = entry->d_type;
+        listing->count++;
+        namesLength += length;
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+// returns the listing of a directory, from the cache if the directory hasn't changed since it was read. release it with releaseListing
+static DirectoryListing* getListing(const char* path)
+{
+    struct stat st;
+    if (stat(path, &st) == -1 || !S_ISDIR(st.st_mode))
+        return NULL;
+
+    // the slot of the directory, or else the least recently used one that isn't being iterated over
+    DirectoryListing* slot = NULL;
+    for (int i = 0; i < DIRECTORY_CACHE_SIZE; i++)
+    {
+        DirectoryListing* listing = &directoryCache[i];
+        if (listing->names && listing->dev == st.st_dev && listing->ino == st.st_ino)
+        {
+            if (listing->reusable && listing->mtime.tv_sec == st.st_mtim.tv_sec && listing->mtime.tv_nsec == st.st_mtim.tv_nsec)
+            {
+                listing->lastUse = ++useCounter;
+                listing->pins++;
+                return listing;
+            }
+
+            slot = listing->pins ? NULL : listing;
+            break;
+        }
+
+        if (!listing->pins && (!slot || listing->lastUse < slot->lastUse))
+            slot = listing;
+    }
+
+    // every slot is being iterated over, the listing is read for this use only
+    if (!slot)
+    {
+        slot = (DirectoryListing*)calloc(1, sizeof(DirectoryListing));
+        if (!slot)
+            return NULL;
+    }
+    else
+    {
+        freeListing(slot);
+        slot->cached = true;
+    }
+
+    if (readListing(path, slot) == -1)
+    {
+        if (!slot->cached)
+            free(slot);
+        return NULL;
+    }
+
+    // timestamps are coarse, a change in the same tick as the read wouldn't change the mtime. the listing is only trusted again if the directory was last changed a while before it was read
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    slot->dev = st.st_dev;
+    slot->ino = st.st_ino;
+    slot->mtime = st.st_mtim;
+    slot->reusable = st.st_mtim.tv_sec < now.tv_sec - 1;
+    slot->lastUse = ++useCounter;
+    slot->pins = 1;
+    return slot;
+}
+
+static void releaseListing(DirectoryListing* listing)
+{
+    listing->pins--;
+    if (!listing->cached)
+    {
+        freeListing(listing);
+        free(listing);
+    }
+}
+
+void clearDirectoryCache(void)
+{
+    for (int i = 0; i < DIRECTORY_CACHE_SIZE; i++)
+        freeListing(&directoryCache[i]);
+}
+
+/*-------------------------------Expansion--------------------------------------------*/
+
+static int addMatch(GlobMatches* matches, const char* path, size_t length)
+{
+    if (matches->count == matches->capacity)
+    {
+        size_t capacity = matches->capacity ? matches->capacity * 2 : 16;
+        char** paths = (char**)realloc(matches->paths, capacity * sizeof(char*));
+        if (!paths)
+        {
+            LOG_DEBUG("Realloc error. Failed to reallocate memory for the matches.\n");
+            return -1;
+        }
+        matches->paths = paths;
+        matches->capacity = capacity;
+    }
+
+    char* copy = (char*)arenaAlloc(&matches->strings, length + 1);
+    if (!copy)
+        return -1;
+    memcpy(copy, path, length);
+    copy[length] = '\0';
+
+    matches->paths[matches->count++] = copy;
+    return 0;
+}
+
+// whether the first length characters of a pattern have a wildcard in them
+static bool componentHasWildcards(const char* pattern, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (pattern[i] == '*' || pattern[i] == '?' || pattern[i] == '[')
+            return true;
+        if (pattern[i] == '\\')
+            i++;
+    }
+    return false;
+}
+
+static int matchRecursive(char* path, size_t length, const char* rest, GlobMatches* matches);
+
+// matches the rest of a pattern in the directory that path holds (length characters of it, empty for the current directory, else ending with a '/'). the matches are added as they are found, the whole path is built in the same buffer
+static int matchComponents(char* path, size_t length, const char* pattern, GlobMatches* matches)
+{
+    const char* slash = strchr(pattern, '/');
+    size_t componentLength = slash ? (size_t)(slash - pattern) : strlen(pattern);
+
+    // the slashes after the component are kept as they are
+    size_t slashes = 0;
+    while (slash && slash[slashes] == '/')
+        slashes++;
+    const char* rest = slash ? slash + slashes : NULL;
+    bool last = !rest || !*rest;
+
+    if (!componentHasWildcards(pattern, componentLength))
+    {
+        // a literal component is taken as it is, without reading the directory
+        if (length + componentLength + slashes >= PATH_MAX)
+            return 0;
+        length += removeEscapes(path + length, pattern, componentLength);
+        memcpy(path + length, pattern + componentLength, slashes);
+        length += slashes;
+        path[length] = '\0';
+
+        struct stat st;
+        if (!last)
+            return matchComponents(path, length, rest, matches);
+        return lstat(path, &st) == 0 ? addMatch(matches, path, length) : 0;
+    }
+
+    // a trailing `**` matches everything under the directory, like `**/*`, and a trailing `**/` every directory
+    if (componentLength == 2 && pattern[0] == '*' && pattern[1] == '*')
+        return matchRecursive(path, length, last ? (slash ? "*/" : "*") : rest, matches);
+
+    path[length] = '\0';
+    DirectoryListing* listing = getListing(length ? path : ".");
+    if (!listing)
+        return 0;
+
+    int status = 0;
+    for (size_t i = 0; i < listing->count && status == 0; i++)
+    {
+        const char* name = listing->names + listing->entries[i].offset;
+        unsigned char type = listing->entries[i].type;
+
+        // hidden files only match a pattern that starts with a '.' of its own
+        if (name[0] == '.' && pattern[0] != '.')
+            continue;
+
+        if (!matchWildcard(pattern, componentLength, name))
+            continue;
+
+        // a component with more after it has to be a directory. the type is known for most entries without a stat
+        if (slash && type != DT_DIR && type != DT_LNK && type != DT_UNKNOWN)
+            continue;
+
+        size_t nameLength = strlen(name);
+        if (length + nameLength + slashes >= PATH_MAX)
+            continue;
+        memcpy(path + length, name, nameLength);
+        memcpy(path + length + nameLength, slash ? slash : "", slashes);
+        size_t newLength = length + nameLength + slashes;
+        path[newLength] = '\0';
+
+        if (!last)
+        {
+            status = matchComponents(path, newLength, rest, matches);
+        }
+        else
+        {
+            struct stat st;
+            if (!slash || type == DT_DIR || (stat(path, &st) == 0 && S_ISDIR(st.st_mode)))
+                status = addMatch(matches, path, newLength);
+        }
+    }
+
+    releaseListing(listing);
+    return status;
+}
+
+// matches the rest of a pattern after a `**` component, which stands for the directory in path and every directory under it. the tree is walked in parallel. when the rest is a single component (like in `**/*.c`) it is matched against the names the walk found, else the rest of the pattern is matched in every directory of the tree
+static int matchRecursive(char* path, size_t length, const char* rest, GlobMatches* matches)
+{
+    path[length] = '\0';
+    WalkResult walk;
+    if (walkTree(length ? path : ".", 0, &walk))
+    {
+        freeWalkResult(&walk);
+        return 0;
+    }
+
+    const char* slash = strchr(rest, '/');
+    size_t componentLength = slash ? (size_t)(slash - rest) : strlen(rest);
+    const char* afterSlashes = slash ? slash + strspn(slash, "/") : NULL;
+    bool single = !afterSlashes || !*afterSlashes;
+
+    int status = 0;
+    if (single)
+    {
+        // the directory itself counts as one of the directories, its own entries are matched from the walk as well
+        for (size_t i = 0; i < walk.count && status == 0; i++)
+        {
+            const char* entryPath = walk.entries[i].path;
+            const char* name = strrchr(entryPath, '/');
+            name = name ? name + 1 : entryPath;
+
+            if ((name[0] == '.' && rest[0] != '.') || !matchWildcard(rest, componentLength, name))
+                continue;
+
+            // a pattern with a trailing slash only matches directories
+            unsigned char type = walk.entries[i].type;
+            size_t entryLength = strlen(entryPath);
+            size_t slashes = slash ? strlen(slash) : 0;
+            if (length + entryLength + slashes >= PATH_MAX)
+                continue;
+
+            memcpy(path + length, entryPath, entryLength);
+            memcpy(path + length + entryLength, slash ? slash : "", slashes);
+            path[length + entryLength + slashes] = '\0';
+
+            struct stat st;
+            if (!slash || type == DT_DIR || (type == DT_LNK && stat(path, &st) == 0 && S_ISDIR(st.st_mode)))
+                status = addMatch(matches, path, length + entryLength + slashes);
+        }
+    }
+    else
+    {
+        status = matchComponents(path, length, rest, matches);
+        for (size_t i = 0; i < walk.count && status == 0; i++)
+        {
+            if (walk.entries[i].type != DT_DIR)
+                continue;
+
+            size_t entryLength = strlen(walk.entries[i].path);
+            if (length + entryLength + 1 >= PATH_MAX)
+                continue;
+
+            memcpy(path + length, walk.entries[i].path, entryLength);
+            path[length + entryLength] = '/';
+            status = matchComponents(path, length + entryLength + 1, rest, matches);
+        }
+    }
+
+    freeWalkResult(&walk);
+    return status;
+}
+
+// replaces a leading ~ or ~user by the home directory. returns the word itself if it doesn't start with one, or the home directory is unknown
+static const char* expandTilde(const char* word, GlobMatches* matches)
+{
+    if (word[0] != '~')
+        return word;
+
+    size_t userLength = strcspn(word + 1, "/");
+    const char* home = NULL;
+    if (userLength == 0)
+    {
+        home = getenv("HOME");
+        if (!home)
+        {
+            struct passwd* entry = getpwuid(getuid());
+            home = entry ? entry->pw_dir : NULL;
+        }
+    }
+    else
+    {
+        char user[LOGIN_NAME_MAX + 1];
+        if (userLength <= LOGIN_NAME_MAX)
+        {
+            memcpy(user, word + 1, userLength);
+            user[userLength] = '\0';
+            struct passwd* entry = getpwnam(user);
+            home = entry ? entry->pw_dir : NULL;
+        }
+    }
+
+    if (!home)
+        return word;
+
+    const char* rest = word + 1 + userLength;
+    size_t homeLength = strlen(home);
+    char* expanded = (char*)arenaAlloc(&matches->strings, homeLength + strlen(rest) + 1);
+    if (!expanded)
+        return word;
+
+    memcpy(expanded, home, homeLength);
+    strcpy(expanded + homeLength, rest);
+    return expanded;
+}
+
+// adds a word that is taken as it is, without its escapes
+static int addLiteral(GlobMatches* matches, const char* word)
+{
+    size_t length = strlen(word);
+    char* literal = (char*)arenaAlloc(&matches->strings, length + 1);
+    if (!literal)
+        return -1;
+    return addMatch(matches, literal, removeEscapes(literal, word, length));
+}
+
+static int comparePaths(const void* a, const void* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+int expandGlob(const char* word, GlobMatches* matches)
+{
+    matches->paths = NULL;
+    matches->count = 0;
+    matches->capacity = 0;
+    initArena(&matches->strings, ARENA_BLOCK_SIZE);
+
+    const char* pattern = expandTilde(word, matches);
+
+    // most words aren't patterns, and go through untouched
+    if (!hasWildcards(pattern))
+        return addLiteral(matches, pattern);
+
+    char path[PATH_MAX];
+    size_t length = 0;
+
+    // an absolute pattern starts at the root directory
+    while (pattern[length] == '/' && length < PATH_MAX - 1)
+    {
+        path[length] = '/';
+        length++;
+    }
+
+    if (matchComponents(path, length, pattern + length, matches))
+        return -1;
+
+    if (matches->count == 0)
+        return addLiteral(matches, pattern);
+
+    qsort(matches->paths, matches->count, sizeof(char*), comparePaths);
+    return 0;
+}
+
+void freeGlobMatches(GlobMatches* matches)
+{
+    free(matches->paths);
+    destroyArena(&matches->strings);
+    matches->paths = NULL;
+    matches->count = 0;
+    matches->capacity = 0;
+}